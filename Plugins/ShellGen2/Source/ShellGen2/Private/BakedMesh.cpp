@@ -19,6 +19,8 @@
 
 #include "BakedMesh.h"
 
+#include "Async/ParallelFor.h"
+
 std::vector<FVector> FBakedMesh::calculate_normals() const {
   std::vector<FVector> normals(vertices->size());
   for(auto&& n : normals) {
@@ -51,40 +53,65 @@ std::vector<FVector> FBakedMesh::calculate_normals() const {
   return normals;
 }
 
-// It's been 19 years since the last time I did this, so I confess I had to use
-// a reference: <https://stackoverflow.com/a/5257471>
-void FBakedMesh::build_tangent_space
-(const TArray<FVertexInstanceID>& viid_map,
- TMeshAttributesRef<FVertexInstanceID, FVector>& out_normals,
- TMeshAttributesRef<FVertexInstanceID, FVector>& out_tangents,
- TMeshAttributesRef<FVertexInstanceID, float>& out_binormal_signs) const {
-  std::vector<FVector> normals(vertices->size());
-  std::vector<FVector> tangents(vertices->size());
-  std::vector<FVector> binormals(vertices->size());
-  for(auto&& n : normals) n = FVector(0.0f);
-  for(auto&& t : tangents) t = FVector(0.0f);
-  for(auto&& b : binormals) b = FVector(0.0f);
-  /* For each triangle... */
+std::vector<FVector2D> FBakedMesh::calculate_uv_footprints() const {
+  std::vector<FVector2D> footprints(texcoords->size(), FVector2D(0.0f, 0.0f));
+  auto grow = [&](uint32_t a_index, uint32_t b_index) {
+    auto& a = (*texcoords)[a_index];
+    auto& b = (*texcoords)[b_index];
+    /* V jumps from 1 to -1 halfway around every ring (see build_shell_at).
+       Comparing |V| instead makes that jump go away, and costs nothing
+       anywhere else. */
+    FVector2D d(fabs(a.X - b.X), fabs(fabs(a.Y) - fabs(b.Y)));
+    auto& fa = footprints[a_index];
+    auto& fb = footprints[b_index];
+    fa.X = fmax(fa.X, d.X); fa.Y = fmax(fa.Y, d.Y);
+    fb.X = fmax(fb.X, d.X); fb.Y = fmax(fb.Y, d.Y);
+  };
+  /* Every triangle spans two neighbouring rings, so its edges give us both
+     the step around the ring and the step to the next ring. */
   for(auto it = indices->cbegin(); it != indices->cend();) {
-    /* (The three points of the triangle) */
     auto a_index = *it++;
     auto b_index = *it++;
     auto c_index = *it++;
+    grow(a_index, b_index);
+    grow(b_index, c_index);
+    grow(c_index, a_index);
+  }
+  return footprints;
+}
+
+// It's been 19 years since the last time I did this, so I confess I had to use
+// a reference: <https://stackoverflow.com/a/5257471>
+void FBakedMesh::calculate_tangent_space(std::vector<FVector>& out_normals,
+                                         std::vector<FVector>& out_tangents,
+                                         std::vector<float>&
+                                         out_binormal_signs,
+                                         bool with_tangents) const {
+  struct face_basis { FVector n, t, u; };
+  size_t num_vertices = vertices->size();
+  size_t num_triangles = indices->size() / 3;
+  /* Work out each triangle's contribution in parallel... */
+  std::vector<face_basis> faces(num_triangles);
+  ParallelFor(num_triangles, [&](int32 triangle) {
+    /* (The three points of the triangle) */
+    auto a_index = (*indices)[triangle*3];
+    auto b_index = (*indices)[triangle*3+1];
+    auto c_index = (*indices)[triangle*3+2];
     auto& a = (*vertices)[a_index];
     auto& b = (*vertices)[b_index];
     auto& c = (*vertices)[c_index];
+    auto d = b-a;
+    auto e = c-a;
+    auto& face = faces[triangle];
+    /* Calculate the face normal */
+    auto n = FVector::CrossProduct(d, e);
+    face.n = n;
+    if(!with_tangents) return;
     auto& h = (*texcoords)[a_index];
     auto& k = (*texcoords)[b_index];
     auto& l = (*texcoords)[c_index];
-    auto d = b-a;
-    auto e = c-a;
     auto f = k-h;
     auto g = l-h;
-    /* Calculate the face normal */
-    auto n = FVector::CrossProduct(d, e);
-    normals[a_index] += n;
-    normals[b_index] += n;
-    normals[c_index] += n;
     /* Calculate the actual tangent and binormal */
     float fs = f.X;
     float ft = f.Y;
@@ -95,25 +122,61 @@ void FBakedMesh::build_tangent_space
     FVector u = det * (-gs * d + fs * e);
     FVector tprime = t - (n | t) * n;
     FVector uprime = u - (n | u) * n - (tprime | u) * tprime;
-    tangents[a_index] += tprime;
-    tangents[b_index] += tprime;
-    tangents[c_index] += tprime;
-    binormals[a_index] += uprime;
-    binormals[b_index] += uprime;
-    binormals[c_index] += uprime;
+    face.t = tprime;
+    face.u = uprime;
+  });
+  /* ...then add them up in the same order as always, so the sums come out
+     exactly the same... */
+  std::vector<face_basis> sums(num_vertices,
+                               face_basis{FVector(0.0f), FVector(0.0f),
+                                          FVector(0.0f)});
+  for(size_t triangle = 0; triangle < num_triangles; ++triangle) {
+    auto& face = faces[triangle];
+    for(int corner = 0; corner < 3; ++corner) {
+      auto& sum = sums[(*indices)[triangle*3+corner]];
+      sum.n += face.n;
+      sum.t += face.t;
+      sum.u += face.u;
+    }
   }
-  for(unsigned int i = 0; i < vertices->size(); ++i) {
+  /* ...and finish each vertex in parallel. */
+  out_normals.resize(num_vertices);
+  out_tangents.resize(num_vertices);
+  out_binormal_signs.resize(num_vertices);
+  ParallelFor(num_vertices, [&](int32 i) {
     /* Output = normalized input */
-    FVector n = normals[i];
-    FVector t = tangents[i];
-    FVector u = binormals[i];
+    FVector n = sums[i].n;
+    FVector t = sums[i].t;
+    FVector u = sums[i].u;
     n.Normalize(1.0 / 131072.0);
-    t.Normalize(1.0 / 131072.0);
-    u.Normalize(1.0 / 131072.0);
+    if(with_tangents) {
+      t.Normalize(1.0 / 131072.0);
+      u.Normalize(1.0 / 131072.0);
+    }
+    else {
+      FVector unused;
+      n.FindBestAxisVectors(t, unused);
+      u = n ^ t;
+    }
     // handedness, not sign, sigh.
     float u_sign = ((n ^ t) | u) < 0.0 ? -1.0f : 1.0f;
-    out_normals.Set(viid_map[i], n);
-    out_tangents.Set(viid_map[i], t);
-    out_binormal_signs.Set(viid_map[i], u_sign);
+    out_normals[i] = n;
+    out_tangents[i] = t;
+    out_binormal_signs[i] = u_sign;
+  });
+}
+
+void FBakedMesh::build_tangent_space
+(const TArray<FVertexInstanceID>& viid_map,
+ TMeshAttributesRef<FVertexInstanceID, FVector>& out_normals,
+ TMeshAttributesRef<FVertexInstanceID, FVector>& out_tangents,
+ TMeshAttributesRef<FVertexInstanceID, float>& out_binormal_signs) const {
+  std::vector<FVector> normals, tangents;
+  std::vector<float> binormal_signs;
+  calculate_tangent_space(normals, tangents, binormal_signs);
+  for(unsigned int i = 0; i < vertices->size(); ++i) {
+    out_normals.Set(viid_map[i], normals[i]);
+    out_tangents.Set(viid_map[i], tangents[i]);
+    out_binormal_signs.Set(viid_map[i], binormal_signs[i]);
   }
 }
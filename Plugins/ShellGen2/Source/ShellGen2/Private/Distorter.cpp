@@ -26,7 +26,7 @@ FBakedMesh UDistorter::ApplyDistortions(const FBakedMesh& mesh,
     return mesh;
   }
   for(const auto& distortion : distorts) {
-    if(distortion->Map == nullptr) {
+    if(!distortion->has_source()) {
       UE_LOG(LogTemp, Warning, TEXT("Attempted to apply distortions with a nulled-out LoadedGrayPNG!"));
       return mesh;
     }
@@ -40,20 +40,151 @@ FBakedMesh UDistorter::ApplyDistortions(const FBakedMesh& mesh,
     UE_LOG(LogTemp, Error, TEXT("Calculating normals went horribly wrong somehow! (Needed %u, got %u)"), (unsigned int)vertices.size(), (unsigned int)normals.size());
     return mesh;
   }
-  /* Now, at each vertex... */
+  /* Only work out how far apart the vertices are if somebody cares. */
+  std::vector<FVector2D> footprints;
+  for(const auto& distortion : distorts) {
+    if(distortion->wants_footprints()) {
+      footprints = mesh.calculate_uv_footprints();
+      break;
+    }
+  }
+  /* Sample all the distortions, a batch of vertices at a time... */
+  std::vector<float> amounts(vertices.size(), 0.0f);
+  std::vector<float> temp(vertices.size());
+  for(const auto& distortion : distorts) {
+    distortion->sample_many(texcoords.data(), temp.data(), temp.size(),
+                            footprints.empty() ? nullptr : footprints.data());
+    for(size_t index = 0; index < amounts.size(); ++index) {
+      amounts[index] += temp[index];
+    }
+  }
+  /* ...and then push each vertex along its normal. */
   auto new_vertices = std::make_shared<std::vector<FVector>>();
   new_vertices->reserve(vertices.size());
-  for(auto index = 0; index < normals.size(); ++index) {
-    auto v = vertices[index];
-    auto& n = normals[index];
-    auto& uv = texcoords[index];
-    /* For each distortion... */
-    float amount = 0.0f;
-    for(const auto& distortion : distorts) {
-      amount += distortion->sample(uv);
-    }
-    v += n * amount;
-    new_vertices->push_back(v);
+  for(size_t index = 0; index < normals.size(); ++index) {
+    new_vertices->push_back(vertices[index] + normals[index] * amounts[index]);
+  }
+  return FBakedMesh(std::move(new_vertices), mesh.texcoords, mesh.indices);
+}
+
+UDistorter* UDistorter::MakeDistorter() {
+  return NewObject<UDistorter>();
+}
+
+void UDistorter::ClearDistortionCache() {
+  cached_vertices = nullptr;
+  cached_texcoords = nullptr;
+  cached_indices = nullptr;
+  cached_normals.clear();
+  cached_normals.shrink_to_fit();
+  cached_footprints.clear();
+  cached_footprints.shrink_to_fit();
+  cached_fields.clear();
+}
+
+FBakedMesh UDistorter::ApplyDistortionsCached
+(const FBakedMesh& mesh, const TArray<UDistortion*>& distorts) {
+  if(!mesh.vertices || !mesh.indices || !mesh.texcoords) {
+    UE_LOG(LogTemp, Warning, TEXT("Attempted to apply distortions to a nulled-out mesh!"));
+    return mesh;
+  }
+  for(const auto& distortion : distorts) {
+    if(!distortion->has_source()) {
+      UE_LOG(LogTemp, Warning, TEXT("Attempted to apply distortions with a nulled-out LoadedGrayPNG!"));
+      return mesh;
+    }
+  }
+  /* Different mesh? Start over. */
+  if(mesh.vertices != cached_vertices || mesh.texcoords != cached_texcoords
+     || mesh.indices != cached_indices) {
+    ClearDistortionCache();
+    cached_normals = mesh.calculate_normals();
+    if(cached_normals.size() != mesh.vertices->size()) {
+      UE_LOG(LogTemp, Error, TEXT("Calculating normals went horribly wrong somehow! (Needed %u, got %u)"), (unsigned int)mesh.vertices->size(), (unsigned int)cached_normals.size());
+      ClearDistortionCache();
+      return mesh;
+    }
+    cached_vertices = mesh.vertices;
+    cached_texcoords = mesh.texcoords;
+    cached_indices = mesh.indices;
+  }
+  const auto& vertices = *mesh.vertices;
+  const auto& texcoords = *mesh.texcoords;
+  size_t count = vertices.size();
+  std::vector<distortion_snapshot> snapshots;
+  snapshots.reserve(distorts.Num());
+  for(const auto& distortion : distorts) {
+    snapshots.emplace_back(distortion->snapshot());
+  }
+  /* Sample every source we don't already have, and forget the ones nobody
+     is using anymore (so that the cache doesn't grow forever while somebody
+     drags a UV slider around). */
+  std::vector<cached_field> fields;
+  for(const auto& snapshot : snapshots) {
+    snapshot.for_each_source([&](const distortion_source& source) {
+      for(const auto& field : fields) {
+        if(field.source == source) return;
+      }
+      for(auto& field : cached_fields) {
+        if(field.source == source && !field.values.empty()) {
+          fields.emplace_back(std::move(field));
+          return;
+        }
+      }
+      if(source.filter_by_footprint && cached_footprints.empty()) {
+        cached_footprints = mesh.calculate_uv_footprints();
+      }
+      cached_field field;
+      field.source = source;
+      field.values.resize(count);
+      source.sample_many(texcoords.data(), field.values.data(), count,
+                         cached_footprints.empty() ? nullptr
+                         : cached_footprints.data());
+      fields.emplace_back(std::move(field));
+    });
+  }
+  cached_fields = std::move(fields);
+  auto field_for = [this](const distortion_source& source) -> const float* {
+    for(const auto& field : cached_fields) {
+      if(field.source == source) return field.values.data();
+    }
+    check(false); // we just put it there!
+    return nullptr;
+  };
+  /* The usual case is a list of Distortions that aren't composed with
+     anything. Then each one is just a multiply-add on its field, and we can
+     do all of them in the same pass that moves the vertices. */
+  bool all_simple = true;
+  for(const auto& snapshot : snapshots) {
+    if(!snapshot.composed.empty()) { all_simple = false; break; }
+  }
+  auto new_vertices = std::make_shared<std::vector<FVector>>(count);
+  auto& out = *new_vertices;
+  if(all_simple) {
+    std::vector<const float*> simple_fields;
+    float total_offset = 0.0f;
+    for(const auto& snapshot : snapshots) {
+      simple_fields.push_back(field_for(snapshot.source));
+      total_offset += snapshot.magnitude_offset;
+    }
+    for(size_t index = 0; index < count; ++index) {
+      float amount = total_offset;
+      for(size_t n = 0; n < snapshots.size(); ++n) {
+        amount += simple_fields[n][index] * snapshots[n].magnitude;
+      }
+      out[index] = vertices[index] + cached_normals[index] * amount;
+    }
+  }
+  else {
+    std::vector<float> amounts(count, 0.0f);
+    std::vector<float> temp(count);
+    for(const auto& snapshot : snapshots) {
+      snapshot.apply_many(field_for, temp.data(), count);
+      for(size_t index = 0; index < count; ++index) amounts[index] += temp[index];
+    }
+    for(size_t index = 0; index < count; ++index) {
+      out[index] = vertices[index] + cached_normals[index] * amounts[index];
+    }
   }
   return FBakedMesh(std::move(new_vertices), mesh.texcoords, mesh.indices);
 }
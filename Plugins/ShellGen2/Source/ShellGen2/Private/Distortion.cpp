@@ -18,3 +18,144 @@
  */
 
 #include "Distortion.h"
+
+namespace {
+  // How many points we transform at a time. Small enough to live on the
+  // stack, big enough to keep the sampler busy.
+  constexpr size_t SAMPLE_BLOCK = 256;
+}
+
+void distortion_source::sample_many(const FVector2D* uvs, float* out,
+                                    size_t count,
+                                    const FVector2D* footprints) const {
+  bool filtered = filter_by_footprint && footprints != nullptr;
+  float us[SAMPLE_BLOCK], vs[SAMPLE_BLOCK], texel_footprints[SAMPLE_BLOCK];
+  for(size_t start = 0; start < count; start += SAMPLE_BLOCK) {
+    size_t len = count - start < SAMPLE_BLOCK ? count - start : SAMPLE_BLOCK;
+    const FVector2D* in = uvs + start;
+    float* dst = out + start;
+    for(size_t n = 0; n < len; ++n) {
+      us[n] = in[n].X * uv_scale.X + uv_offset.X;
+      vs[n] = in[n].Y * uv_scale.Y + uv_offset.Y;
+    }
+    if(ornament) {
+      // no mip levels to worry about here, it's all closed-form
+      if(!wrap_at_v) {
+        for(size_t n = 0; n < len; ++n) {
+          if(vs[n] < 0.0f) vs[n] *= -1.0f;
+        }
+      }
+      ornament->sample_many(us, vs, dst, len);
+      continue;
+    }
+    // the sampler does the mirroring itself
+    if(filtered) {
+      // uv_scale already has the map size baked in, so this is in texels
+      const FVector2D* in_footprints = footprints + start;
+      for(size_t n = 0; n < len; ++n) {
+        texel_footprints[n] = fmax(fabs(in_footprints[n].X * uv_scale.X),
+                                   fabs(in_footprints[n].Y * uv_scale.Y));
+      }
+      image->sample_many_filtered(us, vs, texel_footprints, dst, len,
+                                  !wrap_at_v);
+    }
+    else {
+      image->sample_many(us, vs, dst, len, !wrap_at_v);
+    }
+  }
+}
+
+namespace {
+  void compose_many(ComposeOperation op, float* dst, const float* other,
+                    size_t len) {
+    switch(op) {
+    case ComposeOperation::ComposeAdd:
+      for(size_t n = 0; n < len; ++n) dst[n] += other[n];
+      break;
+    case ComposeOperation::ComposeMultiply:
+      for(size_t n = 0; n < len; ++n) dst[n] *= other[n];
+      break;
+    case ComposeOperation::ComposeDivide:
+      for(size_t n = 0; n < len; ++n) dst[n] /= other[n];
+      break;
+    }
+  }
+}
+
+void distortion_snapshot::sample_many(const FVector2D* uvs, float* out,
+                                      size_t count,
+                                      const FVector2D* footprints) const {
+  float other[SAMPLE_BLOCK];
+  for(size_t start = 0; start < count; start += SAMPLE_BLOCK) {
+    size_t len = count - start < SAMPLE_BLOCK ? count - start : SAMPLE_BLOCK;
+    const FVector2D* in = uvs + start;
+    const FVector2D* in_footprints = footprints ? footprints + start : nullptr;
+    float* dst = out + start;
+    source.sample_many(in, dst, len, in_footprints);
+    for(size_t n = 0; n < len; ++n) {
+      dst[n] = dst[n] * magnitude + magnitude_offset;
+    }
+    for(const auto& pair : composed) {
+      pair.second.sample_many(in, other, len, in_footprints);
+      compose_many(pair.first, dst, other, len);
+    }
+  }
+}
+
+void distortion_snapshot::apply_many
+(const std::function<const float*(const distortion_source&)>& field_for,
+ float* out, size_t count) const {
+  const float* field = field_for(source);
+  for(size_t n = 0; n < count; ++n) {
+    out[n] = field[n] * magnitude + magnitude_offset;
+  }
+  if(composed.empty()) return;
+  std::vector<float> other(count);
+  for(const auto& pair : composed) {
+    pair.second.apply_many(field_for, other.data(), count);
+    compose_many(pair.first, out, other.data(), count);
+  }
+}
+
+void distortion_snapshot::for_each_source
+(const std::function<void(const distortion_source&)>& visit) const {
+  visit(source);
+  for(const auto& pair : composed) {
+    pair.second.for_each_source(visit);
+  }
+}
+
+void UDistortion::sample_many(const FVector2D* uvs, float* out,
+                              size_t count, const FVector2D* footprints) {
+  snapshot().sample_many(uvs, out, count, footprints);
+}
+
+bool UDistortion::wants_footprints() const {
+  if(FilterByFootprint) return true;
+  for(const auto& other : ComposeWith) {
+    if(other->wants_footprints()) return true;
+  }
+  return false;
+}
+
+distortion_source UDistortion::get_source() const {
+  distortion_source ret;
+  ret.image = Map ? Map->GetImage() : nullptr;
+  ret.uv_scale = UVScale;
+  ret.uv_offset = UVOffset;
+  ret.wrap_at_v = WrapAtV;
+  ret.filter_by_footprint = FilterByFootprint;
+  return ret;
+}
+
+distortion_snapshot UDistortion::snapshot() const {
+  distortion_snapshot ret;
+  ret.source = get_source();
+  ret.magnitude = Magnitude;
+  ret.magnitude_offset = MagnitudeOffset;
+  ret.composed.reserve(ComposeWith.Num());
+  for(int i = 0; i < ComposeWith.Num(); ++i) {
+    ret.composed.emplace_back(Operation[i], ComposeWith[i]->snapshot());
+  }
+  return ret;
+}
@@ -18,6 +18,7 @@
  */
 
 #include "DistortionLib.h"
+#include "OrnamentDistortion.h"
 
 UDistortionLib::UDistortionLib(const class FObjectInitializer& _) : Super(_) {}
 
@@ -26,7 +27,8 @@ UDistortion* UDistortionLib::MakeDistortion(ULoadedGrayPNG* Map,
                                             FVector2D UVOffset,
                                             float Magnitude,
                                             float MagnitudeOffset,
-					    bool WrapAtV) {
+					    bool WrapAtV,
+					    bool FilterByFootprint) {
   auto ret = NewObject<UDistortion>();
   ret->Map = Map;
   ret->UVScale = NumUVRepeats;
@@ -42,22 +44,48 @@ UDistortion* UDistortionLib::MakeDistortion(ULoadedGrayPNG* Map,
   ret->Magnitude = Magnitude;
   ret->MagnitudeOffset = MagnitudeOffset;
   ret->WrapAtV = WrapAtV;
+  ret->FilterByFootprint = FilterByFootprint;
+  return ret;
+}
+
+UDistortion* UDistortionLib::MakeOrnamentDistortion(float RibsPerWhorl,
+                                                    float RibSharpness,
+                                                    float RibHeight,
+                                                    float NodesAcrossSection,
+                                                    float NodeSharpness,
+                                                    float NodeHeight,
+                                                    float SpiralCords,
+                                                    float SpiralTwistPerWhorl,
+                                                    float SpiralSharpness,
+                                                    float SpiralHeight,
+                                                    float Magnitude,
+                                                    float MagnitudeOffset,
+                                                    bool WrapAtV) {
+  auto ret = NewObject<UOrnamentDistortion>();
+  ret->RibsPerWhorl = RibsPerWhorl;
+  ret->RibSharpness = RibSharpness;
+  ret->RibHeight = RibHeight;
+  ret->NodesAcrossSection = NodesAcrossSection;
+  ret->NodeSharpness = NodeSharpness;
+  ret->NodeHeight = NodeHeight;
+  ret->SpiralCords = SpiralCords;
+  ret->SpiralTwistPerWhorl = SpiralTwistPerWhorl;
+  ret->SpiralSharpness = SpiralSharpness;
+  ret->SpiralHeight = SpiralHeight;
+  ret->Magnitude = Magnitude;
+  ret->MagnitudeOffset = MagnitudeOffset;
+  ret->WrapAtV = WrapAtV;
   return ret;
 }
 
 UDistortion* UDistortionLib::MakeComposedDistortion(UDistortion* a,
                                                     UDistortion* b,
                                                     ComposeOperation op) {
-  auto ret = NewObject<UDistortion>();
-  ret->Map = a->Map;
-  ret->UVScale = a->UVScale;
-  ret->UVOffset = a->UVOffset;
-  ret->Magnitude = a->Magnitude;
+  // Duplicate rather than copying field by field, so that `a` can be any
+  // kind of Distortion (ornaments have a lot more fields than maps).
+  auto ret = DuplicateObject<UDistortion>(a, GetTransientPackage());
   ret->MagnitudeOffset = b->MagnitudeOffset;
-  ret->ComposeWith = a->ComposeWith;
-  ret->Operation = a->Operation;
   ret->ComposeWith.Add(b);
   ret->Operation.Add(op);
-  ret->WrapAtV = a->WrapAtV;
   return ret;
 }
@@ -0,0 +1,372 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "GltfWriter.h"
+#include "cook_path.h"
+#include "fast_format.h"
+#include "mesh_export.h"
+#include "glb_format.h"
+
+#include <cstring>
+#include <vector>
+
+// glTF's magic numbers
+static constexpr uint32 GLB_MAGIC = 0x46546C67; // "glTF"
+static constexpr uint32 GLB_VERSION = 2;
+static constexpr uint32 GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+static constexpr uint32 GLB_CHUNK_BIN = 0x004E4942; // "BIN\0"
+static constexpr int GL_FLOAT = 5126;
+static constexpr int GL_UNSIGNED_INT = 5125;
+static constexpr int GL_ARRAY_BUFFER = 34962;
+static constexpr int GL_ELEMENT_ARRAY_BUFFER = 34963;
+static constexpr int GL_TRIANGLES = 4;
+
+void UGltfWriter::OutputGlbFile(const TArray<FString>& comments,
+                                const TArray<FBakedMesh>& meshes,
+                                const TArray<FTransform>& transforms,
+                                const FString& filename,
+                                bool include_normals,
+                                bool& saving_succeeded,
+                                FString& failure_reason) {
+  failure_reason = "";
+  saving_succeeded = write_glb_file(comments, meshes, transforms, filename,
+                                    include_normals, failure_reason);
+}
+
+namespace {
+  void append_json_string(std::string& out, const std::string& in) {
+    out += '"';
+    for(char c : in) {
+      switch(c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if(static_cast<unsigned char>(c) < 0x20) {
+          static const char hex[] = "0123456789abcdef";
+          out += "\\u00";
+          out += hex[c >> 4];
+          out += hex[c & 15];
+        }
+        else out += c;
+      }
+    }
+    out += '"';
+  }
+  void append_json_floats(std::string& out, const float* values, int count) {
+    out += '[';
+    for(int n = 0; n < count; ++n) {
+      if(n != 0) out += ',';
+      append_float(out, values[n]);
+    }
+    out += ']';
+  }
+}
+
+std::string build_glb_json(const TArray<FString>& comments,
+                           const std::vector<glb_mesh_layout>& layouts,
+                           const TArray<FTransform>& transforms,
+                           bool include_normals, uint64 bin_length) {
+  std::string json;
+  json += "{\"asset\":{\"version\":\"2.0\","
+    "\"generator\":\"Shell Shape Generator 2\"";
+  if(comments.Num() != 0) {
+    json += ",\"extras\":{\"comments\":[";
+    for(int n = 0; n < comments.Num(); ++n) {
+      if(n != 0) json += ',';
+      append_json_string(json, std::string(TCHAR_TO_UTF8(*comments[n])));
+    }
+    json += "]}";
+  }
+  json += "},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],";
+  // Node 0 turns Z-up into Y-up (-90° around X). Everything else hangs off
+  // of it.
+  json += "\"nodes\":[{\"name\":\"ZUpToYUp\","
+    "\"rotation\":[-0.707106781,0,0,0.707106781],\"children\":[";
+  for(size_t m = 0; m < layouts.size(); ++m) {
+    if(m != 0) json += ',';
+    append_uint(json, m + 1);
+  }
+  json += "]}";
+  for(size_t m = 0; m < layouts.size(); ++m) {
+    json += ",{\"name\":\"mesh";
+    append_uint(json, m);
+    json += '"';
+    if(layouts[m].mesh_index >= 0) {
+      json += ",\"mesh\":";
+      append_uint(json, layouts[m].mesh_index);
+    }
+    if(m < static_cast<size_t>(transforms.Num())) {
+      const auto& transform = transforms[m];
+      FVector translation = transform.GetTranslation();
+      FQuat rotation = transform.GetRotation();
+      FVector scale = transform.GetScale3D();
+      float t[3] = {translation.X, translation.Y, translation.Z};
+      float r[4] = {rotation.X, rotation.Y, rotation.Z, rotation.W};
+      float s[3] = {scale.X, scale.Y, scale.Z};
+      json += ",\"translation\":";
+      append_json_floats(json, t, 3);
+      json += ",\"rotation\":";
+      append_json_floats(json, r, 4);
+      json += ",\"scale\":";
+      append_json_floats(json, s, 3);
+    }
+    json += '}';
+  }
+  json += "],\"meshes\":[";
+  bool first = true;
+  for(size_t m = 0; m < layouts.size(); ++m) {
+    const auto& layout = layouts[m];
+    if(layout.mesh_index < 0) continue;
+    if(!first) json += ',';
+    first = false;
+    int accessor = layout.first_accessor;
+    json += "{\"name\":\"mesh";
+    append_uint(json, m);
+    json += "\",\"primitives\":[{\"attributes\":{\"POSITION\":";
+    append_uint(json, accessor++);
+    if(include_normals) {
+      json += ",\"NORMAL\":";
+      append_uint(json, accessor++);
+    }
+    json += ",\"TEXCOORD_0\":";
+    append_uint(json, accessor++);
+    json += "},\"indices\":";
+    append_uint(json, accessor++);
+    json += ",\"mode\":";
+    append_uint(json, GL_TRIANGLES);
+    json += "}]}";
+  }
+  json += "],\"buffers\":[{\"byteLength\":";
+  append_uint(json, bin_length);
+  json += "}],\"bufferViews\":[";
+  first = true;
+  auto view = [&](uint64 offset, uint64 length, int target) {
+    if(!first) json += ',';
+    first = false;
+    json += "{\"buffer\":0,\"byteOffset\":";
+    append_uint(json, offset);
+    json += ",\"byteLength\":";
+    append_uint(json, length);
+    json += ",\"target\":";
+    append_uint(json, target);
+    json += '}';
+  };
+  for(const auto& layout : layouts) {
+    if(layout.mesh_index < 0) continue;
+    view(layout.positions_offset, layout.vertex_count * 12, GL_ARRAY_BUFFER);
+    if(include_normals)
+      view(layout.normals_offset, layout.vertex_count * 12, GL_ARRAY_BUFFER);
+    view(layout.texcoords_offset, layout.vertex_count * 8, GL_ARRAY_BUFFER);
+    view(layout.indices_offset, layout.index_count * 4,
+         GL_ELEMENT_ARRAY_BUFFER);
+  }
+  json += "],\"accessors\":[";
+  first = true;
+  int buffer_view = 0;
+  auto accessor = [&](int component_type, uint64 count, const char* type) {
+    if(!first) json += ',';
+    first = false;
+    json += "{\"bufferView\":";
+    append_uint(json, buffer_view++);
+    json += ",\"componentType\":";
+    append_uint(json, component_type);
+    json += ",\"count\":";
+    append_uint(json, count);
+    json += ",\"type\":\"";
+    json += type;
+    json += '"';
+  };
+  for(const auto& layout : layouts) {
+    if(layout.mesh_index < 0) continue;
+    accessor(GL_FLOAT, layout.vertex_count, "VEC3");
+    // POSITION is the one accessor that *has* to have bounds.
+    float min[3] = {layout.min.X, layout.min.Y, layout.min.Z};
+    float max[3] = {layout.max.X, layout.max.Y, layout.max.Z};
+    json += ",\"min\":";
+    append_json_floats(json, min, 3);
+    json += ",\"max\":";
+    append_json_floats(json, max, 3);
+    json += '}';
+    if(include_normals) {
+      accessor(GL_FLOAT, layout.vertex_count, "VEC3");
+      json += '}';
+    }
+    accessor(GL_FLOAT, layout.vertex_count, "VEC2");
+    json += '}';
+    accessor(GL_UNSIGNED_INT, layout.index_count, "SCALAR");
+    json += '}';
+  }
+  json += "]}";
+  return json;
+}
+static void append_glb_u32(std::string& out, uint32 value) {
+  char bytes[4] = {
+    char(value & 0xFF), char((value >> 8) & 0xFF),
+    char((value >> 16) & 0xFF), char((value >> 24) & 0xFF),
+  };
+  out.append(bytes, 4);
+}
+
+std::string glb_header(uint32 json_length, uint64 bin_length) {
+  std::string header;
+  append_glb_u32(header, GLB_MAGIC);
+  append_glb_u32(header, GLB_VERSION);
+  append_glb_u32(header, static_cast<uint32>(12 + 8 + json_length
+                                             + 8 + bin_length));
+  append_glb_u32(header, json_length);
+  append_glb_u32(header, GLB_CHUNK_JSON);
+  return header;
+}
+
+std::string glb_bin_header(uint64 bin_length) {
+  std::string header;
+  append_glb_u32(header, static_cast<uint32>(bin_length));
+  append_glb_u32(header, GLB_CHUNK_BIN);
+  return header;
+}
+
+bool finish_glb_json(std::string& json, uint64 bin_length,
+                     FString& failure_reason) {
+  // Chunks have to be padded out to four bytes. JSON with spaces...
+  while(json.size() % 4 != 0) json += ' ';
+  // (...and BIN never needs padding, because everything in it is made out of
+  // four-byte values.)
+  if(12 + 8 + json.size() + 8 + bin_length > 0xFFFFFFFFu) {
+    failure_reason = "Too much data for a single glTF file";
+    return false;
+  }
+  return true;
+}
+
+void make_glb_normals_unit(FVector* normals, size_t count) {
+  for(size_t n = 0; n < count; ++n) {
+    float length_squared = normals[n].SizeSquared();
+    if(!(length_squared > 1.0e-12f))
+      normals[n] = FVector(0.0f, 0.0f, 1.0f);
+    else if(FMath::Abs(length_squared - 1.0f) > 1.0e-5f)
+      normals[n] *= FMath::InvSqrt(length_squared);
+  }
+}
+
+uint64 layout_glb_mesh(glb_mesh_layout& layout, bool include_normals,
+                       uint64 bin_length, int& next_accessor,
+                       int& next_mesh) {
+  // glTF doesn't allow empty accessors, so an empty mesh is just a node.
+  if(layout.vertex_count == 0 || layout.index_count == 0) return bin_length;
+  layout.mesh_index = next_mesh++;
+  layout.first_accessor = next_accessor;
+  next_accessor += include_normals ? 4 : 3;
+  layout.positions_offset = bin_length;
+  bin_length += layout.vertex_count * 12;
+  if(include_normals) {
+    layout.normals_offset = bin_length;
+    bin_length += layout.vertex_count * 12;
+  }
+  layout.texcoords_offset = bin_length;
+  bin_length += layout.vertex_count * 8;
+  layout.indices_offset = bin_length;
+  bin_length += layout.index_count * 4;
+  return bin_length;
+}
+
+std::unique_ptr<IFileHandle> open_glb_file(const FString& filename,
+                                           FString& path) {
+  IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+  path = shellgen_cook_path(filename);
+  if(!path.EndsWith(FString(".glb"))) path += ".glb";
+  return std::unique_ptr<IFileHandle>(PlatformFile.OpenWrite(*path));
+}
+
+bool write_glb_file(const TArray<FString>& comments,
+                    const TArray<FBakedMesh>& meshes,
+                    const TArray<FTransform>& transforms,
+                    const FString& filename, bool include_normals,
+                    FString& failure_reason,
+                    export_progress* progress) {
+  if(!check_export_meshes(meshes, failure_reason)) return false;
+  // The whole point is to copy our arrays straight into the file, and glTF
+  // is little-endian.
+  if(!PLATFORM_LITTLE_ENDIAN) {
+    failure_reason = "glTF export is only supported on little-endian machines";
+    return false;
+  }
+  if(progress) progress->set_total(count_export_triangles(meshes));
+  /* Work out where everything goes. */
+  std::vector<glb_mesh_layout> layouts(meshes.Num());
+  uint64 bin_length = 0;
+  int next_accessor = 0, next_mesh = 0;
+  for(int m = 0; m < meshes.Num(); ++m) {
+    auto& layout = layouts[m];
+    const auto& vertices = *meshes[m].vertices;
+    layout.vertex_count = vertices.size();
+    layout.index_count = meshes[m].indices->size() / 3 * 3;
+    if(meshes[m].texcoords->size() != vertices.size()) {
+      failure_reason = "A mesh had the wrong number of texcoords";
+      return false;
+    }
+    bin_length = layout_glb_mesh(layout, include_normals, bin_length,
+                                 next_accessor, next_mesh);
+    if(layout.mesh_index < 0) continue;
+    layout.min = layout.max = vertices[0];
+    for(const auto& v : vertices) {
+      layout.min = layout.min.ComponentMin(v);
+      layout.max = layout.max.ComponentMax(v);
+    }
+  }
+  std::string json = build_glb_json(comments, layouts, transforms,
+                                    include_normals, bin_length);
+  if(!finish_glb_json(json, bin_length, failure_reason)) return false;
+  FString path;
+  auto file = open_glb_file(filename, path);
+  if(!file) {
+    failure_reason = "Unable to write file";
+    return false;
+  }
+  buffered_file_writer o(*file);
+  o.write(glb_header(json.size(), bin_length));
+  o.write(json);
+  o.write(glb_bin_header(bin_length));
+  /* Now the data, exactly as it sits in memory. */
+  for(int m = 0; m < meshes.Num(); ++m) {
+    if(progress && progress->is_cancelled()) break;
+    const auto& layout = layouts[m];
+    if(layout.mesh_index < 0) continue;
+    const auto& mesh = meshes[m];
+    static_assert(sizeof(FVector) == 12, "FVector isn't three floats?!");
+    static_assert(sizeof(FVector2D) == 8, "FVector2D isn't two floats?!");
+    o.write(reinterpret_cast<const char*>(mesh.vertices->data()),
+            layout.vertex_count * 12);
+    if(include_normals) {
+      auto normals = mesh.calculate_normals();
+      make_glb_normals_unit(normals.data(), normals.size());
+      o.write(reinterpret_cast<const char*>(normals.data()),
+              layout.vertex_count * 12);
+    }
+    o.write(reinterpret_cast<const char*>(mesh.texcoords->data()),
+            layout.vertex_count * 8);
+    o.write(reinterpret_cast<const char*>(mesh.indices->data()),
+            layout.index_count * 4);
+    if(progress) progress->advance(layout.index_count / 3);
+  }
+  return finish_export_file(file, o, path, progress, failure_reason);
+}
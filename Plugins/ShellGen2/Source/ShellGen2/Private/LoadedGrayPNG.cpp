@@ -19,6 +19,12 @@
 
 #include "LoadedGrayPNG.h"
 #include "cook_path.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformFilemanager.h"
+
+#include <cstring>
+#include <mutex>
 
 #include <libPNG/libPNG-1.5.27/png.h>
 
@@ -31,9 +37,8 @@ static void read_from_ifile(png_structp libpng, png_bytep buf, size_t len) {
 
 // This is like the fifteenth time I've copied-and-pasted SubCritical's PNG loading
 // code. Heh. -SB
-ULoadedGrayPNG* ULoadedGrayPNG::LoadGrayPNG(const FString& filename) {
+static std::shared_ptr<loaded_gray_png> decode_gray_png(const FString& path) {
   IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-  FString path = shellgen_cook_path(filename);
   std::unique_ptr<IFileHandle> file(PlatformFile.OpenRead(*path));
   if(!file) return nullptr;
   png_structp libpng = png_create_read_struct(PNG_LIBPNG_VER_STRING,
@@ -45,6 +50,14 @@ ULoadedGrayPNG* ULoadedGrayPNG::LoadGrayPNG(const FString& filename) {
     return nullptr;
   }
   auto image = std::make_shared<loaded_gray_png>();
+  // Locals changed between setjmp and longjmp are indeterminate afterward,
+  // so the buffers live on the heap, in a holder that's set up (and never
+  // touched again) before the setjmp. Then the error path frees them safely.
+  struct decode_buffers {
+    std::shared_ptr<uint8_t> pixels;
+    std::unique_ptr<png_bytep[]> png_rows;
+  };
+  const std::unique_ptr<decode_buffers> buffers(new decode_buffers());
 #pragma warning(suppress : 4611) // yes, thanks, MSVC, I know!
   if(setjmp(png_jmpbuf(libpng))) {
     png_destroy_read_struct(&libpng, &info, nullptr);
@@ -87,14 +100,17 @@ ULoadedGrayPNG* ULoadedGrayPNG::LoadGrayPNG(const FString& filename) {
   image->width = width;
   image->height = height;
   // don't check width*height for overflow because... oh well
-  image->pixels = std::unique_ptr<uint8_t[]>(new uint8_t[width * height]);
-  image->rows = std::unique_ptr<uint8_t*[]>(new uint8_t*[height]);
-  uint8_t* rowp = image->pixels.get();
+  auto& pixels = buffers->pixels;
+  auto& png_rows = buffers->png_rows;
+  pixels.reset(new uint8_t[width * height + loaded_gray_png::PIXEL_PADDING](),
+               std::default_delete<uint8_t[]>());
+  png_rows.reset(new png_bytep[height]);
+  uint8_t* rowp = pixels.get();
   for(png_uint_32 n = 0; n < height; ++n) {
-    image->rows[n] = rowp;
+    png_rows[n] = rowp;
     rowp += width;
   }
-  png_read_image(libpng, (png_bytepp)image->rows.get());
+  png_read_image(libpng, png_rows.get());
   // we tested this, and determined that this code was needed. later this code
   // turned out not to be needed. Ooooookay.
   /*
@@ -106,12 +122,187 @@ ULoadedGrayPNG* ULoadedGrayPNG::LoadGrayPNG(const FString& filename) {
   }
   */
   png_read_end(libpng, info);
+  png_destroy_read_struct(&libpng, &info, nullptr);
   // no more errors!
+  image->pixels = pixels.get();
+  image->storage = std::move(pixels);
+  image->finish_loading();
+  return image;
+}
+
+namespace {
+  /* The raw cache file is just this header, followed by the pixels (and
+     PIXEL_PADDING bytes of zeroes, so that we can map it and sample it
+     directly). All little-endian, because we never move these files between
+     machines anyway. */
+  struct raw_cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+    // What the PNG looked like when we decoded it.
+    int64_t source_timestamp;
+    int64_t source_size;
+  };
+  const char RAW_CACHE_MAGIC[8] = {'S','S','G','2','G','R','A','Y'};
+  constexpr uint32_t RAW_CACHE_VERSION = 1;
+  FString raw_cache_path(const FString& path) {
+    return path + TEXT(".graycache");
+  }
+  // Keeps the mapping alive for as long as any image points into it.
+  struct mapped_cache {
+    std::unique_ptr<IMappedFileHandle> handle;
+    std::unique_ptr<IMappedFileRegion> region;
+    ~mapped_cache() {
+      // the region has to go before the file it's in
+      region = nullptr;
+      handle = nullptr;
+    }
+  };
+  std::shared_ptr<loaded_gray_png> load_raw_cache(const FString& path,
+                                                  int64_t timestamp,
+                                                  int64_t size) {
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    auto mapped = std::make_shared<mapped_cache>();
+    mapped->handle.reset(PlatformFile.OpenMapped(*raw_cache_path(path)));
+    if(!mapped->handle) return nullptr;
+    int64 file_size = mapped->handle->GetFileSize();
+    if(file_size < static_cast<int64>(sizeof(raw_cache_header))) return nullptr;
+    mapped->region.reset(mapped->handle->MapRegion(0, file_size));
+    if(!mapped->region) return nullptr;
+    const uint8* base = mapped->region->GetMappedPtr();
+    raw_cache_header header;
+    memcpy(&header, base, sizeof(header));
+    if(memcmp(header.magic, RAW_CACHE_MAGIC, sizeof(header.magic))
+       || header.version != RAW_CACHE_VERSION
+       || header.source_timestamp != timestamp
+       || header.source_size != size
+       || file_size != static_cast<int64>(sizeof(header))
+       + static_cast<int64>(header.width) * header.height
+       + loaded_gray_png::PIXEL_PADDING) {
+      return nullptr;
+    }
+    auto image = std::make_shared<loaded_gray_png>();
+    image->width = header.width;
+    image->height = header.height;
+    image->pixels = base + sizeof(header);
+    image->storage = std::move(mapped);
+    image->finish_loading();
+    return image;
+  }
+  void save_raw_cache(const FString& path, const loaded_gray_png& image,
+                      int64_t timestamp, int64_t size) {
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    FString final_path = raw_cache_path(path);
+    FString temp_path = final_path + TEXT(".tmp");
+    raw_cache_header header;
+    memcpy(header.magic, RAW_CACHE_MAGIC, sizeof(header.magic));
+    header.version = RAW_CACHE_VERSION;
+    header.width = image.width;
+    header.height = image.height;
+    header.reserved = 0;
+    header.source_timestamp = timestamp;
+    header.source_size = size;
+    {
+      std::unique_ptr<IFileHandle> file(PlatformFile.OpenWrite(*temp_path));
+      if(!file) return;
+      // (the padding bytes are zero in both kinds of storage)
+      if(!file->Write(reinterpret_cast<const uint8*>(&header), sizeof(header))
+         || !file->Write(image.pixels,
+                         static_cast<int64>(image.width) * image.height
+                         + loaded_gray_png::PIXEL_PADDING)) {
+        file = nullptr;
+        PlatformFile.DeleteFile(*temp_path);
+        return;
+      }
+    }
+    // Write-then-rename, so that a half-written cache is never mistaken for
+    // a whole one.
+    PlatformFile.DeleteFile(*final_path);
+    if(!PlatformFile.MoveFile(*final_path, *temp_path))
+      PlatformFile.DeleteFile(*temp_path);
+  }
+  // Every image anybody still has, so that we don't decode the same file
+  // twice.
+  struct registry_entry {
+    std::weak_ptr<loaded_gray_png> image;
+    int64_t timestamp;
+    int64_t size;
+  };
+  std::mutex registry_mutex;
+  TMap<FString, registry_entry> registry;
+}
+
+std::shared_ptr<loaded_gray_png>
+ULoadedGrayPNG::acquire_image(const FString& filename, bool use_disk_cache) {
+  IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+  FString path = shellgen_cook_path(filename);
+  int64_t size = PlatformFile.FileSize(*path);
+  if(size < 0) return nullptr;
+  int64_t timestamp = PlatformFile.GetTimeStamp(*path).GetTicks();
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto entry = registry.Find(path);
+    if(entry != nullptr && entry->timestamp == timestamp
+       && entry->size == size) {
+      auto image = entry->image.lock();
+      if(image) return image;
+    }
+  }
+  // Not holding the lock while we decode, so that other files can be looked
+  // up (and decoded) in the meantime. If two threads decode the same file at
+  // once, whichever finishes last wins; both results are identical anyway.
+  std::shared_ptr<loaded_gray_png> image;
+  if(use_disk_cache) image = load_raw_cache(path, timestamp, size);
+  if(!image) {
+    image = decode_gray_png(path);
+    if(!image) return nullptr;
+    if(use_disk_cache) save_raw_cache(path, *image, timestamp, size);
+  }
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  // tidy up after images nobody wants anymore while we're here
+  for(auto it = registry.CreateIterator(); it; ++it) {
+    if(it.Value().image.expired()) it.RemoveCurrent();
+  }
+  registry.Add(path, registry_entry{image, timestamp, size});
+  return image;
+}
+
+ULoadedGrayPNG* ULoadedGrayPNG::LoadGrayPNG(const FString& filename,
+                                            bool UseDiskCache) {
+  auto image = acquire_image(filename, UseDiskCache);
+  if(!image) return nullptr;
   ULoadedGrayPNG* ret = NewObject<ULoadedGrayPNG>();
   ret->image = std::move(image);
   return ret;
 }
 
+void ULoadedGrayPNG::LoadGrayPNGsAsync(const TArray<FString>& paths,
+                                       FGrayPNGsLoaded OnLoaded,
+                                       bool UseDiskCache) {
+  Async(EAsyncExecution::ThreadPool, [paths, OnLoaded, UseDiskCache]() {
+    std::vector<std::shared_ptr<loaded_gray_png> > images(paths.Num());
+    ParallelFor(paths.Num(), [&](int32 n) {
+      images[n] = acquire_image(paths[n], UseDiskCache);
+    });
+    // UObjects only get made on the game thread.
+    AsyncTask(ENamedThreads::GameThread, [images, OnLoaded]() {
+      TArray<ULoadedGrayPNG*> maps;
+      maps.Reserve(images.size());
+      for(const auto& image : images) {
+        ULoadedGrayPNG* map = nullptr;
+        if(image) {
+          map = NewObject<ULoadedGrayPNG>();
+          map->image = image;
+        }
+        maps.Add(map);
+      }
+      OnLoaded.ExecuteIfBound(maps);
+    });
+  });
+}
+
 // Why is this here? Everybody's gotta be somewhere
 const float BYTE_TO_FLOAT[256] = {
   0.0f / 255.0f,
@@ -18,36 +18,76 @@
  */
 
 #include "MakeStaticMeshLib.h"
+#include "static_mesh_build.h"
+#include "ShellTopologyUserData.h"
+#include "Components/StaticMeshComponent.h"
 #include "Engine/StaticMesh.h"
 #include "MeshDescriptionBuilder.h"
 #include "StaticMeshAttributes.h"
+#include "StaticMeshResources.h"
+#include "Misc/Crc.h"
+#include "RenderingThread.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
 
 UMakeStaticMeshLib::UMakeStaticMeshLib(const class FObjectInitializer& _)
   : Super(_) {}
 
-UStaticMesh* UMakeStaticMeshLib::BakedMeshToStaticMesh(const FBakedMesh& in) {
+// Vertices get filled in this many at a time per worker.
+static constexpr int32 FILL_CHUNK_SIZE = 16384;
+
+std::unique_ptr<FMeshDescription>
+make_mesh_description(const FBakedMesh& in, bool compute_tangents) {
   if(in.vertices == nullptr) return nullptr; // nulled out mesh...
   auto& vertices = *in.vertices;
   auto& texcoords = *in.texcoords;
   auto& indices = *in.indices;
-  FMeshDescription mdesc;
+  const int32 num_vertices = vertices.size();
+  auto ret = std::make_unique<FMeshDescription>();
+  FMeshDescription& mdesc = *ret;
   FStaticMeshAttributes attr(mdesc);
   attr.Register();
-  mdesc.ReserveNewVertices(vertices.size());
-  mdesc.ReserveNewVertexInstances(vertices.size());
+  mdesc.ReserveNewVertices(num_vertices);
+  mdesc.ReserveNewVertexInstances(num_vertices);
   mdesc.ReserveNewTriangles(indices.size()/3);
+  // A fresh mesh description hands out IDs in order, so vertex n, and its
+  // one and only instance, are both n. That means we can make all the
+  // elements first and then fill in their attributes all at once, straight
+  // into the attribute arrays, instead of one call per attribute per vertex.
+  TArray<FVertexInstanceID> viid_map;
+  viid_map.SetNum(num_vertices, false);
+  for(int32 n = 0; n < num_vertices; ++n) {
+    FVertexID vid = mdesc.CreateVertex();
+    viid_map[n] = mdesc.CreateVertexInstance(vid);
+    check(vid.GetValue() == n && viid_map[n].GetValue() == n);
+  }
+  std::vector<FVector> normals, tangents;
+  std::vector<float> binormal_signs;
+  in.calculate_tangent_space(normals, tangents, binormal_signs,
+                             compute_tangents);
+  {
+    auto positions = attr.GetVertexPositions().GetRawArray();
+    auto uvs = attr.GetVertexInstanceUVs().GetRawArray(0);
+    auto out_normals = attr.GetVertexInstanceNormals().GetRawArray();
+    auto out_tangents = attr.GetVertexInstanceTangents().GetRawArray();
+    auto out_binormal_signs =
+      attr.GetVertexInstanceBinormalSigns().GetRawArray();
+    int32 num_chunks = (num_vertices + FILL_CHUNK_SIZE - 1) / FILL_CHUNK_SIZE;
+    ParallelFor(num_chunks, [&](int32 chunk) {
+      int32 begin = chunk * FILL_CHUNK_SIZE;
+      int32 end = FMath::Min(begin + FILL_CHUNK_SIZE, num_vertices);
+      for(int32 n = begin; n < end; ++n) {
+        positions[n] = vertices[n];
+        uvs[n] = texcoords[n];
+        out_normals[n] = normals[n];
+        out_tangents[n] = tangents[n];
+        out_binormal_signs[n] = binormal_signs[n];
+      }
+    });
+  }
   FMeshDescriptionBuilder builder;
   builder.SetMeshDescription(&mdesc);
-  TArray<FVertexInstanceID> viid_map;
   auto all_group = builder.AppendPolygonGroup();
-  viid_map.SetNum(vertices.size(), false);
-  for(int32_t n = 0; n < vertices.size(); ++n) {
-    FVertexID vid = builder.AppendVertex(vertices[n]);
-    FVertexInstanceID viid = builder.AppendInstance(vid);
-    // we'll build the normals later
-    builder.SetInstance(viid, texcoords[n], FVector(0.0f, 0.0f, 0.0f));
-    viid_map[n] = viid;
-  }
   for(int32_t n = 0; n < indices.size(); n += 3) {
     // 0, 2, 1? yeah, to invert the winding, because apparently UE4 wants
     // clockwise winding because DirectX
@@ -56,14 +96,160 @@ UStaticMesh* UMakeStaticMeshLib::BakedMeshToStaticMesh(const FBakedMesh& in) {
 			   viid_map[indices[n+1]],
 			   all_group);
   }
-  UStaticMesh* ret = NewObject<UStaticMesh>();
-  ret->StaticMaterials.Add(FStaticMaterial());
-  auto normals = mdesc.VertexInstanceAttributes().GetAttributesRef<FVector>(MeshAttribute::VertexInstance::Normal);
-  auto tangents = mdesc.VertexInstanceAttributes().GetAttributesRef<FVector>(MeshAttribute::VertexInstance::Tangent);
-  auto binormal_signs = mdesc.VertexInstanceAttributes().GetAttributesRef<float>(MeshAttribute::VertexInstance::BinormalSign);
-  in.build_tangent_space(viid_map, normals, tangents, binormal_signs);
+  return ret;
+}
+
+UStaticMesh* make_static_mesh(const TArray<const FMeshDescription*>& lods,
+                              UStaticMesh* reuse) {
+  UStaticMesh* ret = reuse;
+  if(ret == nullptr) ret = NewObject<UStaticMesh>();
+  if(ret->StaticMaterials.Num() == 0)
+    ret->StaticMaterials.Add(FStaticMaterial());
+  UStaticMesh::FBuildMeshDescriptionsParams params;
+  // It's a transient mesh. There's no package to dirty, and dirtying one
+  // (on the game thread, no less) is not free.
+  params.bMarkPackageDirty = false;
+  // (If we're reusing a mesh, this takes care of releasing its old render
+  // data, and of any components that were using it.)
+  ret->BuildFromMeshDescriptions(lods, params);
+  return ret;
+}
+
+bool UShellTopologyUserData::matches(const FBakedMesh& mesh) const {
+  return mesh.vertices != nullptr
+    && mesh.vertices->size() == vertex_count
+    && mesh.indices->size() == index_count
+    && FCrc::MemCrc32(mesh.indices->data(),
+                      mesh.indices->size() * sizeof(uint32_t)) == index_crc;
+}
+
+void UShellTopologyUserData::remember(const FBakedMesh& mesh) {
+  vertex_count = mesh.vertices->size();
+  index_count = mesh.indices->size();
+  index_crc = FCrc::MemCrc32(mesh.indices->data(),
+                             index_count * sizeof(uint32_t));
+}
+
+static void remember_topology(UStaticMesh* mesh, const FBakedMesh& in) {
+  auto topology = Cast<UShellTopologyUserData>
+    (mesh->GetAssetUserDataOfClass(UShellTopologyUserData::StaticClass()));
+  if(topology == nullptr) {
+    topology = NewObject<UShellTopologyUserData>(mesh);
+    mesh->AddAssetUserData(topology);
+  }
+  topology->remember(in);
+}
+
+// Overwrites the vertices of `mesh` with the ones from `in`, if it was made
+// from a mesh with the same triangles. Returns false if it wasn't.
+//
+// The new vertices go into the CPU-side copies of the vertex buffers, and
+// the render resources (ray tracing geometry included) are made again from
+// those, so nothing goes back to the old shape the next time the engine
+// re-makes them. Every component using the mesh gets its render state and
+// bounds refreshed, not just the one we were handed.
+static bool try_patch_static_mesh(UStaticMesh* mesh, const FBakedMesh& in,
+                                  bool compute_tangents) {
+  if(mesh->RenderData == nullptr || mesh->RenderData->LODResources.Num() != 1)
+    return false;
+  auto topology = Cast<UShellTopologyUserData>
+    (mesh->GetAssetUserDataOfClass(UShellTopologyUserData::StaticClass()));
+  if(topology == nullptr || !topology->matches(in)) return false;
+  auto& lod = mesh->RenderData->LODResources[0];
+  auto& position_buffer = lod.VertexBuffers.PositionVertexBuffer;
+  auto& vertex_buffer = lod.VertexBuffers.StaticMeshVertexBuffer;
+  // (BuildFromMeshDescriptions keeps the CPU-side copies. If they're gone
+  // anyway, there's nothing to patch.)
+  if(position_buffer.GetNumVertices() != in.vertices->size()
+     || vertex_buffer.GetNumTexCoords() != 1
+     || position_buffer.GetVertexData() == nullptr
+     || vertex_buffer.GetTangentData() == nullptr
+     || vertex_buffer.GetTexCoordData() == nullptr)
+    return false;
+  auto& vertices = *in.vertices;
+  auto& texcoords = *in.texcoords;
+  int32 num_vertices = vertices.size();
+  std::vector<FVector> normals, tangents;
+  std::vector<float> binormal_signs;
+  in.calculate_tangent_space(normals, tangents, binormal_signs,
+                             compute_tangents);
+  // Takes every component using the mesh off the screen until this goes out
+  // of scope, then puts them back with new bounds.
+  FStaticMeshComponentRecreateRenderStateContext recreate(mesh, false, true);
+  mesh->ReleaseResources();
+  // (the render thread mustn't be reading the CPU-side copies while we
+  // write them)
+  FlushRenderingCommands();
+  int32 num_chunks = (num_vertices + FILL_CHUNK_SIZE - 1) / FILL_CHUNK_SIZE;
+  ParallelFor(num_chunks, [&](int32 chunk) {
+    int32 begin = chunk * FILL_CHUNK_SIZE;
+    int32 end = FMath::Min(begin + FILL_CHUNK_SIZE, num_vertices);
+    for(int32 n = begin; n < end; ++n) {
+      position_buffer.VertexPosition(n) = vertices[n];
+      // (takes care of whichever precision the buffer was built with)
+      vertex_buffer.SetVertexTangents
+        (n, tangents[n],
+         FVector::CrossProduct(normals[n], tangents[n]) * binormal_signs[n],
+         normals[n]);
+      vertex_buffer.SetVertexUV(n, 0, texcoords[n]);
+    }
+  });
+  FBox box(vertices.data(), vertices.size());
+  mesh->RenderData->Bounds = FBoxSphereBounds(box);
+  mesh->CalculateExtendedBounds();
+  mesh->InitResources();
+  return true;
+}
+
+UStaticMesh* UMakeStaticMeshLib::BakedMeshToStaticMesh(const FBakedMesh& in,
+                                                       bool compute_tangents) {
+  auto mdesc = make_mesh_description(in, compute_tangents);
+  if(mdesc == nullptr) return nullptr;
   TArray<const FMeshDescription*> ugh;
-  ugh.Emplace(&mdesc);
-  ret->BuildFromMeshDescriptions(ugh);
+  ugh.Emplace(mdesc.get());
+  UStaticMesh* ret = make_static_mesh(ugh);
+  remember_topology(ret, in);
   return ret;
 }
+
+void UMakeStaticMeshLib::BeginBakedMeshToStaticMesh(const FBakedMesh& in,
+                                                    bool compute_tangents,
+                                                    FStaticMeshReady OnReady) {
+  // The mesh is shared, not copied. Nobody changes a finished mesh in place,
+  // so that's safe.
+  Async(EAsyncExecution::ThreadPool, [in, compute_tangents, OnReady]() {
+    std::shared_ptr<FMeshDescription> mdesc
+      = make_mesh_description(in, compute_tangents);
+    AsyncTask(ENamedThreads::GameThread, [in, mdesc, OnReady]() {
+      UStaticMesh* mesh = nullptr;
+      if(mdesc != nullptr) {
+        TArray<const FMeshDescription*> ugh;
+        ugh.Emplace(mdesc.get());
+        mesh = make_static_mesh(ugh);
+        remember_topology(mesh, in);
+      }
+      OnReady.ExecuteIfBound(mesh);
+    });
+  });
+}
+
+void UMakeStaticMeshLib::UpdateStaticMeshComponent
+(UStaticMeshComponent* component, const FBakedMesh& in,
+ bool compute_tangents) {
+  if(component == nullptr || in.vertices == nullptr) return;
+  UStaticMesh* mesh = component->GetStaticMesh();
+  // Only touch meshes we made. Somebody else's mesh (maybe an asset!) gets
+  // replaced, not overwritten.
+  if(mesh != nullptr
+     && mesh->GetAssetUserDataOfClass(UShellTopologyUserData::StaticClass())
+     == nullptr)
+    mesh = nullptr;
+  if(mesh != nullptr && try_patch_static_mesh(mesh, in, compute_tangents))
+    return;
+  auto mdesc = make_mesh_description(in, compute_tangents);
+  TArray<const FMeshDescription*> ugh;
+  ugh.Emplace(mdesc.get());
+  UStaticMesh* rebuilt = make_static_mesh(ugh, mesh);
+  remember_topology(rebuilt, in);
+  if(rebuilt != component->GetStaticMesh()) component->SetStaticMesh(rebuilt);
+}
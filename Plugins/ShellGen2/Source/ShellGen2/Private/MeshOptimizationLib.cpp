@@ -0,0 +1,53 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "MeshOptimizationLib.h"
+#include "mesh_optimize.h"
+#include "mesh_simplify.h"
+
+UMeshOptimizationLib::UMeshOptimizationLib(const class FObjectInitializer& _)
+  : Super(_) {}
+
+static FVertexCacheStats to_stats(const vertex_cache_stats& in) {
+  FVertexCacheStats ret;
+  ret.acmr = in.acmr;
+  ret.atvr = in.atvr;
+  return ret;
+}
+
+FBakedMesh UMeshOptimizationLib::OptimizeMeshForRendering
+(const FBakedMesh& in, FVertexCacheStats& before, FVertexCacheStats& after) {
+  if(in.vertices == nullptr) return in; // nulled out mesh...
+  size_t vertex_count = in.vertices->size();
+  before = to_stats(analyze_vertex_cache(*in.indices, vertex_count));
+  FBakedMesh reordered(in.vertices, in.texcoords,
+                       std::make_shared<std::vector<uint32_t>>
+                       (optimize_vertex_cache(*in.indices, vertex_count)));
+  FBakedMesh ret = optimize_vertex_fetch(reordered);
+  after = to_stats(analyze_vertex_cache(*ret.indices, vertex_count));
+  return ret;
+}
+
+FBakedMesh UMeshOptimizationLib::SimplifyMesh(const FBakedMesh& in,
+                                              int32 TargetTriangles,
+                                              float MaxError) {
+  if(in.vertices == nullptr) return in; // nulled out mesh...
+  return simplify_mesh(in, FMath::Max(TargetTriangles, 0), MaxError);
+}
@@ -18,12 +18,13 @@
  */
 
 #include "ObjWriter.h"
+#include "cook_path.h"
+#include "fast_format.h"
+#include "mesh_export.h"
+#include "obj_format.h"
 
-#include <sstream>
-
-static FString cook_path(const FString& filename) {
-  return FPaths::ProjectContentDir() + TEXT("/") + filename;
-}
+// This many vertices (or faces) get formatted together by one worker.
+static constexpr size_t OBJ_CHUNK_SIZE = 65536;
 
 void UObjWriter::OutputObjFile(const TArray<FString>& comments,
                                const TArray<FBakedMesh>& meshes,
@@ -32,78 +33,139 @@ void UObjWriter::OutputObjFile(const TArray<FString>& comments,
                                bool& saving_succeeded,
                                FString& failure_reason) {
   failure_reason = "";
-  saving_succeeded = false;
-  std::ostringstream o;
+  saving_succeeded = write_obj_file(comments, meshes, transforms, filename,
+                                    failure_reason);
+}
+
+std::unique_ptr<IFileHandle> open_obj_file(const FString& filename,
+                                           FString& path) {
+  IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+  path = shellgen_cook_path(filename);
+  if(!path.EndsWith(FString(".obj"))) path += ".obj";
+  return std::unique_ptr<IFileHandle>(PlatformFile.OpenWrite(*path));
+}
+
+std::string obj_comment_header(const TArray<FString>& comments) {
+  std::string header;
   for(auto& comment : comments) {
     auto str = std::string(TCHAR_TO_UTF8(*comment));
     auto p = str.cbegin();
-    o << "# ";
+    header += "# ";
     while(p != str.cend()) {
       if(*p == '\r') ++p;
-      else if(*p == '\n') { o << "\n# "; ++p; }
-      else o << *p++;
+      else if(*p == '\n') { header += "\n# "; ++p; }
+      else header += *p++;
     }
-    o << "\n";
+    header += "\n";
   }
+  return header;
+}
+
+void append_obj_vertex(std::string& out, const FVector& v) {
+  out += "v ";
+  append_float(out, v.X);
+  out += ' ';
+  append_float(out, v.Y);
+  out += ' ';
+  append_float(out, v.Z);
+  out += '\n';
+}
+
+void append_obj_texcoord(std::string& out, const FVector2D& uv) {
+  out += "vt ";
+  append_float(out, uv.X);
+  out += ' ';
+  append_float(out, uv.Y);
+  out += '\n';
+}
+
+void append_obj_face(std::string& out, uint64 a, uint64 b, uint64 c) {
+  out += 'f';
+  for(uint64 index : {a, b, c}) {
+    out += ' ';
+    append_uint(out, index);
+    out += '/';
+    append_uint(out, index);
+  }
+  out += '\n';
+}
+
+bool write_obj_file(const TArray<FString>& comments,
+                    const TArray<FBakedMesh>& meshes,
+                    const TArray<FTransform>& transforms,
+                    const FString& filename, FString& failure_reason,
+                    export_progress* progress) {
+  // Check everything before we go clobbering any existing file.
+  if(!check_export_meshes(meshes, failure_reason)) return false;
+  if(progress) progress->set_total(count_export_triangles(meshes));
+  FString path;
+  auto file = open_obj_file(filename, path);
+  if(!file) {
+    failure_reason = "Unable to write file";
+    return false;
+  }
+  buffered_file_writer o(*file);
+  auto write_chunk = [&](const std::string& chunk, size_t) {
+    return !(progress && progress->is_cancelled()) && o.write(chunk);
+  };
+  auto write_faces = [&](const std::string& chunk, size_t num_faces) {
+    if(!write_chunk(chunk, num_faces)) return false;
+    if(progress) progress->advance(num_faces);
+    return true;
+  };
+  o.write(obj_comment_header(comments));
+  std::string header;
   size_t index_offset = 1;
   for(int m = 0; m < meshes.Num(); ++m) {
-    if(meshes.Num() != 1)
-      o << "\n### Mesh " << m << "\no mesh" << m << "\ng mesh" << m << "\n";
-    o << "\n# Vertices\n";
-    auto& mesh = meshes[m];
-    if(!mesh.vertices) {
-      failure_reason = "A mesh was NULL";
-      return;
-    }
-    if(!mesh.indices) {
-      failure_reason = "A mesh had null indices";
-      return;
-    }
-    if(!mesh.texcoords) {
-      failure_reason = "A mesh had null texcoords";
-      return;
+    if(progress && progress->is_cancelled()) break;
+    header.clear();
+    if(meshes.Num() != 1) {
+      header += "\n### Mesh ";
+      append_uint(header, m);
+      header += "\no mesh";
+      append_uint(header, m);
+      header += "\ng mesh";
+      append_uint(header, m);
+      header += "\n";
     }
+    header += "\n# Vertices\n";
+    o.write(header);
+    auto& mesh = meshes[m];
     auto& vertices = *mesh.vertices;
     auto& indices = *mesh.indices;
     auto& texcoords = *mesh.texcoords;
-    if(m < transforms.Num()) {
-      auto& transform = transforms[m];
-      for(unsigned int n = 0; n < vertices.size(); ++n) {
-        FVector& in = vertices[n];
-        FVector out = TransformVector(transform, in);
-        o << "v " << out.X << " " << out.Y << " " << out.Z << "\n";
-      }
-    }
-    else {
-      for(unsigned int n = 0; n < vertices.size(); ++n) {
-        FVector& in = vertices[n];
-        o << "v " << in.X << " " << in.Y << " " << in.Z << "\n";
-      }
-    }
-    o << "\n# Texture coordinates\n";
-    for(unsigned int n = 0; n < texcoords.size(); ++n) {
-      o << "vt " << texcoords[n].X << " " << texcoords[n].Y << "\n";
-    }
-    o << "\n# Faces\n";
-    for(unsigned int n = 0; n+2 < indices.size(); n += 3) {
-      o << "f " << indices[n]+index_offset << "/"
-        << indices[n]+index_offset << " "
-        << indices[n+1]+index_offset << "/"
-        << indices[n+1]+index_offset << " "
-        << indices[n+2]+index_offset << "/"
-        << indices[n+2]+index_offset << "\n";
-    }
-    index_offset += vertices.size() / 3;
-  }
-  auto all = o.str();
-  IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-  FString path = cook_path(filename);
-  if(!path.EndsWith(FString(".obj"))) path += ".obj";
-  std::unique_ptr<IFileHandle> file(PlatformFile.OpenWrite(*path));
-  if(!file || !file->Write(reinterpret_cast<const uint8_t*>(all.data()),
-                           all.length())) {
-    failure_reason = "Unable to write file";
-    return;
+    const FTransform* transform = m < transforms.Num() ? &transforms[m] : nullptr;
+    format_chunks_in_order
+      (vertices.size(), OBJ_CHUNK_SIZE,
+       [&](std::string& out, size_t begin, size_t end) {
+         out.reserve((end - begin) * 40);
+         for(size_t n = begin; n < end; ++n) {
+           append_obj_vertex(out, transform != nullptr
+                             ? TransformVector(*transform, vertices[n])
+                             : vertices[n]);
+         }
+       }, write_chunk);
+    o.write("\n# Texture coordinates\n");
+    format_chunks_in_order
+      (texcoords.size(), OBJ_CHUNK_SIZE,
+       [&](std::string& out, size_t begin, size_t end) {
+         out.reserve((end - begin) * 28);
+         for(size_t n = begin; n < end; ++n) {
+           append_obj_texcoord(out, texcoords[n]);
+         }
+       }, write_chunk);
+    o.write("\n# Faces\n");
+    format_chunks_in_order
+      (indices.size() / 3, OBJ_CHUNK_SIZE,
+       [&](std::string& out, size_t begin, size_t end) {
+         out.reserve((end - begin) * 48);
+         for(size_t n = begin * 3; n < end * 3; n += 3) {
+           append_obj_face(out, indices[n] + index_offset,
+                           indices[n+1] + index_offset,
+                           indices[n+2] + index_offset);
+         }
+       }, write_faces);
+    index_offset += vertices.size();
   }
-  saving_succeeded = true;
+  return finish_export_file(file, o, path, progress, failure_reason);
 }
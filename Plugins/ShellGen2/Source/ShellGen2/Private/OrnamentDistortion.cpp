@@ -0,0 +1,47 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "OrnamentDistortion.h"
+
+ornament_spec UOrnamentDistortion::get_spec() const {
+  ornament_spec ret;
+  ret.ribs_per_whorl = RibsPerWhorl;
+  ret.rib_sharpness = RibSharpness;
+  ret.rib_height = RibHeight;
+  ret.nodes_across_section = NodesAcrossSection;
+  ret.node_sharpness = NodeSharpness;
+  ret.node_height = NodeHeight;
+  ret.spiral_cords = SpiralCords;
+  ret.spiral_twist_per_whorl = SpiralTwistPerWhorl;
+  ret.spiral_sharpness = SpiralSharpness;
+  ret.spiral_height = SpiralHeight;
+  return ret;
+}
+
+float UOrnamentDistortion::sample_source(const FVector2D& uvscaled) {
+  return get_spec().sample(uvscaled.X, uvscaled.Y);
+}
+
+distortion_source UOrnamentDistortion::get_source() const {
+  distortion_source ret = UDistortion::get_source();
+  ret.image = nullptr;
+  ret.ornament = std::make_shared<ornament_spec>(get_spec());
+  return ret;
+}
@@ -0,0 +1,39 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "RadiusInfoLib.h"
+
+URadiusInfoLib::URadiusInfoLib(const class FObjectInitializer& _) : Super(_) {}
+
+int32 URadiusInfoLib::GetCrossSectionLength(const FRadiusInfo& radius_info) {
+  return radius_info.get_cross_section().Num();
+}
+
+FVector URadiusInfoLib::GetCrossSectionPoint(const FRadiusInfo& radius_info,
+                                             int32 index) {
+  auto view = radius_info.get_cross_section();
+  if(!view.IsValidIndex(index)) return FVector::ZeroVector;
+  return view[index];
+}
+
+TArray<FVector> URadiusInfoLib::GetCrossSection(const FRadiusInfo& radius_info) {
+  auto view = radius_info.get_cross_section();
+  return TArray<FVector>(view.GetData(), view.Num());
+}
@@ -23,21 +23,57 @@
 
 UReducedBentleyOttmannLib::UReducedBentleyOttmannLib(const class FObjectInitializer& _) : Super(_) {}
 
+namespace {
+  TArray<LineSeg> cross_section_lines
+  (const TArray<FTransformedCrossSection>& cross_sections) {
+    TArray<LineSeg> lines;
+    size_t line_count = 0;
+    for(auto& cross_section : cross_sections) {
+      line_count += cross_section.points.Num();
+    }
+    lines.Reserve(line_count);
+    for(auto& cross_section : cross_sections) {
+      for(size_t a = 0; a < cross_section.points.Num(); ++a) {
+        size_t b = a + 1;
+        if(b >= cross_section.points.Num()) b = 0;
+        lines.Add(LineSeg{cross_section.points[a] * cross_section.scale + cross_section.translation,
+                          cross_section.points[b] * cross_section.scale + cross_section.translation});
+      }
+    }
+    return lines;
+  }
+  void sort_points(TArray<FVector2D>& points) {
+    points.Sort([](const FVector2D& a, const FVector2D& b) {
+      return a.X < b.X || (a.X == b.X && a.Y < b.Y);
+    });
+  }
+}
+
 TArray<FVector2D> UReducedBentleyOttmannLib::ReducedBentleyOttmann
 (const TArray<FTransformedCrossSection>& cross_sections) {
-  TArray<LineSeg> lines;
-  size_t line_count = 0;
-  for(auto& cross_section : cross_sections) {
-    line_count += cross_section.points.Num();
-  }
-  lines.Reserve(line_count);
-  for(auto& cross_section : cross_sections) {
-    for(size_t a = 0; a < cross_section.points.Num(); ++a) {
-      size_t b = a + 1;
-      if(b >= cross_section.points.Num()) b = 0;
-      lines.Add(LineSeg{cross_section.points[a] * cross_section.scale + cross_section.translation,
-			cross_section.points[b] * cross_section.scale + cross_section.translation});
-    }
+  return bnlytmn(cross_section_lines(cross_sections));
+}
+
+void UReducedBentleyOttmannLib::BenchmarkReducedBentleyOttmann
+(const TArray<FTransformedCrossSection>& cross_sections,
+ int32 iterations,
+ float& old_seconds, float& new_seconds, bool& same_results) {
+  if(iterations < 1) iterations = 1;
+  auto lines = cross_section_lines(cross_sections);
+  TArray<FVector2D> old_points, new_points;
+  double start = FPlatformTime::Seconds();
+  for(int32 n = 0; n < iterations; ++n) old_points = bnlytmn_linear(lines);
+  double middle = FPlatformTime::Seconds();
+  for(int32 n = 0; n < iterations; ++n) new_points = bnlytmn(lines);
+  double end = FPlatformTime::Seconds();
+  old_seconds = (middle - start) / iterations;
+  new_seconds = (end - middle) / iterations;
+  // Both compute each point the same way, but not necessarily with the two
+  // segments in the same order, so allow a little slop.
+  sort_points(old_points);
+  sort_points(new_points);
+  same_results = old_points.Num() == new_points.Num();
+  for(int32 n = 0; same_results && n < old_points.Num(); ++n) {
+    same_results = old_points[n].Equals(new_points[n], 1e-4f);
   }
-  return bnlytmn(lines);
 }
@@ -0,0 +1,57 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "SelfIntersectionLib.h"
+#include "self_intersection.h"
+#include "shell_bvh.h"
+
+USelfIntersectionLib::USelfIntersectionLib(const class FObjectInitializer& _)
+  : Super(_) {}
+
+bool USelfIntersectionLib::FindSelfIntersections
+(const FBakedMesh& in, TArray<FShellSelfIntersection>& intersections) {
+  intersections.Reset();
+  if(in.vertices == nullptr) return false; // nulled out mesh...
+  shell_bvh bvh(in);
+  auto found = find_self_intersections(bvh);
+  if(found.empty()) return false;
+  // The theta of each ring, from its first vertex.
+  auto rings = ring_numbers(in);
+  std::vector<float> ring_theta(rings.empty() ? 0 : rings.back() + 1);
+  for(size_t v = rings.size(); v-- > 0; ) {
+    ring_theta[rings[v]] = (*in.texcoords)[v].X;
+  }
+  auto theta = [&](uint32_t ring) {
+    return ring < ring_theta.size() ? ring_theta[ring] : 0.0f;
+  };
+  intersections.Reserve(found.size());
+  for(const auto& where : found) {
+    FShellSelfIntersection out;
+    out.young_first_ring = where.young_first;
+    out.young_last_ring = where.young_last;
+    out.old_first_ring = where.old_first;
+    out.old_last_ring = where.old_last;
+    out.young_thetas = FVector2D(theta(where.young_first),
+                                 theta(where.young_last));
+    out.old_thetas = FVector2D(theta(where.old_first), theta(where.old_last));
+    intersections.Emplace(std::move(out));
+  }
+  return true;
+}
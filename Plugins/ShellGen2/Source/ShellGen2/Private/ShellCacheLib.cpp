@@ -0,0 +1,46 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ShellCacheLib.h"
+#include "shell_cache.h"
+
+UShellCacheLib::UShellCacheLib(const class FObjectInitializer& _)
+  : Super(_) {}
+
+FShellCacheStats UShellCacheLib::GetShellCacheStats() {
+  shell_cache_stats stats = shell_cache::get().stats();
+  FShellCacheStats ret;
+  ret.hits = stats.hits;
+  ret.misses = stats.misses;
+  if(stats.hits + stats.misses > 0)
+    ret.hit_rate = float(double(stats.hits) / (stats.hits + stats.misses));
+  ret.shells_held = int32(stats.entries);
+  ret.bytes_held = stats.bytes_held;
+  ret.budget = stats.budget;
+  return ret;
+}
+
+void UShellCacheLib::SetShellCacheBudget(int64 Bytes) {
+  shell_cache::get().set_budget(uint64(FMath::Max<int64>(Bytes, 0)));
+}
+
+void UShellCacheLib::ClearShellCache() {
+  shell_cache::get().clear();
+}
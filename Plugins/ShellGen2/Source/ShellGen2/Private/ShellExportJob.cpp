@@ -0,0 +1,113 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ShellExportJob.h"
+#include "mesh_export.h"
+#include "Async/Async.h"
+#include "HAL/PlatformTime.h"
+
+// Don't flood the game thread with progress reports.
+static constexpr double PROGRESS_INTERVAL = 0.1;
+
+UShellExportJob* UShellExportJob::begin
+(std::function<bool(export_progress& progress, FString& failure_reason)> work,
+ FShellExportProgress OnProgress, FShellExportFinished OnFinished) {
+  UShellExportJob* job = NewObject<UShellExportJob>();
+  job->progress = std::make_shared<export_progress>();
+  job->on_progress = OnProgress;
+  job->on_finished = OnFinished;
+  // Nobody else might be holding on to us. Stay alive until we're done.
+  job->AddToRoot();
+  TWeakObjectPtr<UShellExportJob> weak_job(job);
+  auto progress = job->progress;
+  if(OnProgress.IsBound()) {
+    // Only ever called from the thread doing the export, so this doesn't
+    // need to be atomic.
+    auto last_report = std::make_shared<double>(0.0);
+    progress->on_progress = [weak_job, last_report](uint64 written,
+                                                    uint64 total) {
+      double now = FPlatformTime::Seconds();
+      if(now - *last_report < PROGRESS_INTERVAL && written != total) return;
+      *last_report = now;
+      AsyncTask(ENamedThreads::GameThread, [weak_job, written, total]() {
+        UShellExportJob* job = weak_job.Get();
+        if(job != nullptr && !job->finished)
+          job->on_progress.ExecuteIfBound(written, total);
+      });
+    };
+  }
+  Async(EAsyncExecution::ThreadPool, [work, progress, weak_job]() {
+    FString failure_reason;
+    bool ok = work(*progress, failure_reason);
+    if(!ok && failure_reason.IsEmpty()) failure_reason = "Export failed";
+    AsyncTask(ENamedThreads::GameThread, [weak_job, ok, failure_reason]() {
+      UShellExportJob* job = weak_job.Get();
+      if(job != nullptr) job->finish(ok, failure_reason);
+    });
+  });
+  return job;
+}
+
+UShellExportJob* UShellExportJob::BeginExport
+(ShellExportFormat Format, const TArray<FString>& comments,
+ const TArray<FBakedMesh>& meshes, const TArray<FTransform>& transforms,
+ const FString& filename, FShellExportProgress OnProgress,
+ FShellExportFinished OnFinished) {
+  // The meshes are shared, not copied. Nobody changes a finished mesh in
+  // place, so that's safe.
+  return begin([Format, comments, meshes, transforms, filename]
+               (export_progress& progress, FString& failure_reason) {
+    switch(Format) {
+    case ShellExportFormat::ExportObj:
+      return write_obj_file(comments, meshes, transforms, filename,
+                            failure_reason, &progress);
+    case ShellExportFormat::ExportAsciiStl:
+      return write_ascii_stl_file(comments, meshes, transforms, filename,
+                                  failure_reason, &progress);
+    case ShellExportFormat::ExportBinaryStl:
+      return write_binary_stl_file(comments, meshes, transforms, filename,
+                                   failure_reason, &progress);
+    case ShellExportFormat::ExportGlb:
+      return write_glb_file(comments, meshes, transforms, filename, true,
+                            failure_reason, &progress);
+    case ShellExportFormat::Export3mf:
+      return write_3mf_file(comments, meshes, transforms, filename,
+                            failure_reason, &progress);
+    }
+    failure_reason = "Unknown export format";
+    return false;
+  }, OnProgress, OnFinished);
+}
+
+void UShellExportJob::finish(bool ok, const FString& reason) {
+  finished = true;
+  RemoveFromRoot();
+  on_finished.ExecuteIfBound(ok, reason);
+}
+
+void UShellExportJob::Cancel() {
+  if(progress) progress->cancelled = true;
+}
+
+void UShellExportJob::GetExportProgress(int64& TrianglesWritten,
+                                        int64& TrianglesTotal) const {
+  TrianglesWritten = progress ? progress->triangles_written.load() : 0;
+  TrianglesTotal = progress ? progress->triangles_total.load() : 0;
+}
@@ -18,7 +18,17 @@
  */
 
 #include "ShellGenerator.h"
+#include "bnlytmn.hpp"
+#include "shell_cache.h"
+#include "shell_ring_sink.h"
+#include "shell_slicer.h"
+#include "static_mesh_build.h"
+#include "streaming_export.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Engine/StaticMesh.h"
 
+#include <algorithm>
 #include <cassert>
 
 namespace {
@@ -290,6 +300,16 @@ void UShellGenerator::BeginGeneratingShell
   bg.desired_params.young_endcaps = young_endcaps;
   bg.desired_params.old_endcaps = old_endcaps;
   bg.desired_params.spiral_offset_constant = spiral_offset_constant;
+  bg.desired_key = std::make_shared<const shell_cache_key>
+    (make_shell_cache_key(bg.desired_params, bg.desired_distortions));
+  if(shell_cache::get().find(*bg.desired_key, bg.last_baked_mesh,
+                             bg.last_radius_info)) {
+    // Made this exact shell recently. Whatever's in progress is stale now.
+    bg.params_available = false;
+    bg.finished_generation = bg.generation;
+    bg.all_done.notify_all();
+    return;
+  }
   bg.params_available = true;
   if(thread == nullptr)
     thread = std::make_unique<std::thread>(&bg_gen_state::bg_thread_func, &bg);
@@ -309,81 +329,162 @@ void bg_gen_state::bg_thread_func() {
         else {
           cur_generation = generation;
 	  cur_params = desired_params;
+          // Build with the Distortions the key was made from, not whatever
+          // SetDistortions has put in since, or the cache would file this
+          // shell under the wrong key.
+          cur_key = desired_key;
+	  cur_distortions = cur_key->distortions;
+          params_available = false;
           break;
         }
       }
     }
     const auto& p = cur_params;
+    auto curves = p.smoosh();
+    auto radius_info = p.radius_info(curves);
     FBakedMesh mesh;
-    mesh.vertices = std::make_shared<std::vector<FVector>>();
-    mesh.texcoords = std::make_shared<std::vector<FVector2D>>();
-    mesh.indices = std::make_shared<std::vector<uint32_t>>();
-    first_segment_attached = false;
-    last_segment_is_full = true;
-    auto young_curve = smoosh_curves(p.young_cross, p.young_grain, p.curve_subdivision);
-    auto old_curve = smoosh_curves(p.old_cross, p.old_grain, p.curve_subdivision);
-    auto aperture_curve = smoosh_curves(p.aperture_cross, p.aperture_grain, p.curve_subdivision);
-    assert(young_curve.size() == old_curve.size());
-    assert(aperture_curve.size() == old_curve.size());
-    std::vector<FVector> temp;
-    temp.reserve(young_curve.size());
-    TArray<FRadiusInfo> radius_info;
-    radius_info.Reserve(p.radius_requests.Num());
-    for(auto linear_theta : p.radius_requests) {
-      float theta = powf_munged(linear_theta, p.theta_exponent);
-      struct FRadiusInfo i;
-      i.spiral_radius = p.get_tube_center_d(linear_theta, theta);
-      i.tube_normal_radius = p.get_tube_normal_radius(theta);
-      i.tube_binormal_radius = p.get_tube_binormal_radius(theta);
-      auto cross_section = p.curve_at(young_curve, old_curve, aperture_curve,
-				      temp, theta);
-      // hey, isn't it great that Unreal has its own equivalent to std::vector
-      // that isn't compatible at all? What a useful thing.
-      i.cross_section.Reserve(cross_section->size());
-      for(auto el : *cross_section) {
-	i.cross_section.Emplace(std::move(el));
-      }
-      radius_info.Emplace(std::move(i));
+    p.build_shell(mesh, curves, cur_distortions);
+    shell_cache::get().insert(*cur_key, mesh, radius_info);
+    std::unique_lock<std::mutex> lock(mutex);
+    // A newer shell may have come straight out of the cache meanwhile.
+    if(cur_generation < finished_generation) continue;
+    last_baked_mesh = std::move(mesh);
+    last_radius_info = std::move(radius_info);
+    finished_generation = cur_generation;
+    all_done.notify_all();
+  }
+}
+
+shell_curves shell_params::smoosh() const {
+  shell_curves ret;
+  ret.young = smoosh_curves(young_cross, young_grain, curve_subdivision);
+  ret.old = smoosh_curves(old_cross, old_grain, curve_subdivision);
+  ret.aperture = smoosh_curves(aperture_cross, aperture_grain, curve_subdivision);
+  assert(ret.young.size() == ret.old.size());
+  assert(ret.aperture.size() == ret.old.size());
+  return ret;
+}
+
+TArray<FRadiusInfo> shell_params::radius_info(const shell_curves& curves) const {
+  std::vector<FVector> temp;
+  temp.reserve(curves.young.size());
+  // All the cross sections go end to end in one buffer, which every
+  // FRadiusInfo shares, so nobody needs their own copy.
+  auto cross_sections = std::make_shared<std::vector<FVector>>();
+  cross_sections->reserve(curves.young.size() * radius_requests.Num());
+  TArray<FRadiusInfo> radius_info;
+  radius_info.Reserve(radius_requests.Num());
+  for(auto linear_theta : radius_requests) {
+    float theta = powf_munged(linear_theta, theta_exponent);
+    struct FRadiusInfo i;
+    i.spiral_radius = get_tube_center_d(linear_theta, theta);
+    i.tube_normal_radius = get_tube_normal_radius(theta);
+    i.tube_binormal_radius = get_tube_binormal_radius(theta);
+    auto cross_section = curve_at(curves.young, curves.old, curves.aperture,
+                                  temp, theta);
+    i.cross_section_start = cross_sections->size();
+    i.cross_section_count = cross_section->size();
+    cross_sections->insert(cross_sections->end(), cross_section->begin(),
+                           cross_section->end());
+    radius_info.Emplace(std::move(i));
+  }
+  std::shared_ptr<const std::vector<FVector>> shared(std::move(cross_sections));
+  for(auto& i : radius_info) i.cross_sections = shared;
+  return radius_info;
+}
+
+void shell_params::generate(const shell_curves& curves,
+                            shell_ring_sink& sink) const {
+  std::vector<FVector> temp;
+  temp.reserve(curves.young.size());
+  std::vector<FVector> positions;
+  std::vector<FVector2D> texcoords;
+  positions.reserve(curves.young.size());
+  texcoords.reserve(curves.young.size());
+  auto emit_ring = [&]() {
+    sink.ring(positions.data(), texcoords.data(), positions.size());
+    positions.clear();
+    texcoords.clear();
+  };
+  auto emit_endcap = [&](const FVector2D& v, float base_theta) {
+    if(v.Y <= 0.0f) {
+      point_at(positions, texcoords, base_theta + v.X);
     }
-    for(int i = 0; i < p.young_endcaps.Num(); ++i) {
-      const auto& v = p.young_endcaps[i];
-      if(v.Y <= 0.0f) {
-	p.point_at(mesh, v.X);
-	attach_shell_segment(mesh, false, young_curve.size());
-      }
-      else {
-	p.build_shell_at(mesh, young_curve, old_curve, aperture_curve, temp,
-			 v.X, v.Y);
-	attach_shell_segment(mesh, true, young_curve.size());
-      }
+    else {
+      build_shell_at(positions, texcoords, curves.young, curves.old,
+                     curves.aperture, temp, base_theta + v.X, v.Y);
     }
-    float target_age = p.final_age * p.current_age;
-    float theta = 0.0f;
-    while(theta < target_age) {
-      p.build_shell_at(mesh, young_curve, old_curve, aperture_curve, temp,
-		       theta, 1.f);
-      attach_shell_segment(mesh, true, young_curve.size());
-      float buff = fmin(fmax(p.length_per_iteration / fmax(1.f, p.get_tube_center_d(theta, powf_munged(theta, p.theta_exponent))), 0.01f), 3.14159265358979323846264328f/3.0f);
-      theta += buff;
+    emit_ring();
+  };
+  for(int i = 0; i < young_endcaps.Num() && !sink.cancelled(); ++i) {
+    emit_endcap(young_endcaps[i], 0.0f);
+  }
+  float target_age = final_age * current_age;
+  float theta = 0.0f;
+  while(theta < target_age && !sink.cancelled()) {
+    build_shell_at(positions, texcoords, curves.young, curves.old,
+                   curves.aperture, temp, theta, 1.f);
+    emit_ring();
+    theta += theta_step(theta);
+  }
+  for(int i = 0; i < old_endcaps.Num() && !sink.cancelled(); ++i) {
+    emit_endcap(old_endcaps[i], target_age);
+  }
+  sink.finish();
+}
+
+float shell_params::theta_step(float theta) const {
+  return fmin(fmax(length_per_iteration / fmax(1.f, get_tube_center_d(theta, powf_munged(theta, theta_exponent))), 0.01f), 3.14159265358979323846264328f/3.0f);
+}
+
+uint64 shell_params::count_triangles(const shell_curves& curves) const {
+  // Same rings as generate, without building any of them.
+  uint64 ring_size = curves.young.size();
+  uint64 triangles = 0;
+  bool have_last = false, last_is_full = false;
+  auto add_ring = [&](bool is_full) {
+    if(have_last) {
+      triangles += (is_full && last_is_full) ? ring_size * 2
+        : (is_full || last_is_full) ? ring_size : 0;
     }
-    for(int i = 0; i < p.old_endcaps.Num(); ++i) {
-      const auto& v = p.old_endcaps[i];
-      if(v.Y <= 0.0f) {
-	p.point_at(mesh, target_age + v.X);
-	attach_shell_segment(mesh, false, young_curve.size());
-      }
-      else {
-	p.build_shell_at(mesh, young_curve, old_curve, aperture_curve, temp,
-			 target_age + v.X, v.Y);
-	attach_shell_segment(mesh, true, young_curve.size());
-      }
+    have_last = true;
+    last_is_full = is_full;
+  };
+  for(const auto& v : young_endcaps) add_ring(v.Y > 0.0f);
+  float target_age = final_age * current_age;
+  for(float theta = 0.0f; theta < target_age; theta += theta_step(theta)) {
+    add_ring(true);
+  }
+  for(const auto& v : old_endcaps) add_ring(v.Y > 0.0f);
+  return triangles;
+}
+
+void shell_params::build_shell(FBakedMesh& out, const shell_curves& curves,
+                               const std::vector<distortion_snapshot>&
+                               distortions) const {
+  baked_mesh_sink mesh_sink;
+  if(distortions.empty()) {
+    generate(curves, mesh_sink);
+  }
+  else {
+    distorting_ring_sink distorting_sink(mesh_sink, distortions);
+    generate(curves, distorting_sink);
+  }
+  out = std::move(mesh_sink.mesh);
+}
+
+void UShellGenerator::SetDistortions(const TArray<UDistortion*>& distortions) {
+  std::vector<distortion_snapshot> snapshots;
+  snapshots.reserve(distortions.Num());
+  for(const auto& distortion : distortions) {
+    if(distortion == nullptr || !distortion->has_source()) {
+      UE_LOG(LogTemp, Warning, TEXT("Attempted to set distortions with a nulled-out LoadedGrayPNG!"));
+      return;
     }
-    std::unique_lock<std::mutex> lock(mutex);
-    last_baked_mesh = mesh;
-    last_radius_info = radius_info;
-    finished_generation = cur_generation;
-    all_done.notify_all();
+    snapshots.emplace_back(distortion->snapshot());
   }
+  std::unique_lock<std::mutex> lock(bg.mutex);
+  bg.desired_distortions = std::move(snapshots);
 }
 
 bool UShellGenerator::IsGenerationStillInProgress() {
@@ -391,18 +492,281 @@ bool UShellGenerator::IsGenerationStillInProgress() {
   return bg.finished_generation != bg.generation;
 }
 
+namespace {
+  // For Blueprints that still read FRadiusInfo::cross_section. (Done after
+  // letting go of the lock; the shared buffer can't change underneath us.)
+  void copy_cross_sections(TArray<FRadiusInfo>& radius_info) {
+    for(auto& i : radius_info) {
+      if(i.cross_sections == nullptr) continue; // already has its own
+      auto view = i.get_cross_section();
+      i.cross_section = TArray<FVector>(view.GetData(), view.Num());
+      // From now on, the copy is the real thing (edits and all).
+      i.cross_sections = nullptr;
+    }
+  }
+}
+
 FBakedMesh UShellGenerator::TakeLastGeneratedShell(TArray<FRadiusInfo>& i) {
-  std::unique_lock<std::mutex> lock(bg.mutex);
-  i = bg.last_radius_info;
-  return bg.last_baked_mesh;
+  FBakedMesh ret;
+  bool copy;
+  {
+    std::unique_lock<std::mutex> lock(bg.mutex);
+    i = bg.last_radius_info;
+    ret = bg.last_baked_mesh;
+    copy = bg.copy_cross_sections;
+  }
+  if(copy) copy_cross_sections(i);
+  return ret;
 }
 
 FBakedMesh UShellGenerator::BlockForGeneratedShell(TArray<FRadiusInfo>& i) {
+  FBakedMesh ret;
+  bool copy;
+  {
+    std::unique_lock<std::mutex> lock(bg.mutex);
+    while(bg.finished_generation != bg.generation)
+      bg.all_done.wait(lock);
+    i = bg.last_radius_info;
+    ret = bg.last_baked_mesh;
+    copy = bg.copy_cross_sections;
+  }
+  if(copy) copy_cross_sections(i);
+  return ret;
+}
+
+void UShellGenerator::SetCopyCrossSections(bool copy) {
+  std::unique_lock<std::mutex> lock(bg.mutex);
+  bg.copy_cross_sections = copy;
+}
+
+bool UShellGenerator::get_desired_shell
+(shell_params& params, std::vector<distortion_snapshot>& distortions) {
   std::unique_lock<std::mutex> lock(bg.mutex);
-  while(bg.finished_generation != bg.generation)
-    bg.all_done.wait(lock);
-  i = bg.last_radius_info;
-  return bg.last_baked_mesh;
+  if(bg.generation == 0) return false;
+  params = bg.desired_params;
+  distortions = bg.desired_distortions;
+  return true;
+}
+
+void UShellGenerator::GenerateShellToFile(ShellExportFormat Format,
+                                          const TArray<FString>& comments,
+                                          const FString& filename,
+                                          bool& saving_succeeded,
+                                          FString& failure_reason) {
+  shell_params params;
+  std::vector<distortion_snapshot> distortions;
+  if(!get_desired_shell(params, distortions)) {
+    saving_succeeded = false;
+    failure_reason = "BeginGeneratingShell was never called";
+    return;
+  }
+  saving_succeeded = generate_shell_to_file(params, distortions, Format,
+                                            comments, filename,
+                                            failure_reason);
+}
+
+UShellExportJob* UShellGenerator::BeginGeneratingShellToFile
+(ShellExportFormat Format, const TArray<FString>& comments,
+ const FString& filename, FShellExportProgress OnProgress,
+ FShellExportFinished OnFinished) {
+  auto params = std::make_shared<shell_params>();
+  auto distortions = std::make_shared<std::vector<distortion_snapshot>>();
+  bool have_shell = get_desired_shell(*params, *distortions);
+  return UShellExportJob::begin([have_shell, params, distortions, Format,
+                                 comments, filename]
+                                (export_progress& progress,
+                                 FString& failure_reason) {
+    if(!have_shell) {
+      failure_reason = "BeginGeneratingShell was never called";
+      return false;
+    }
+    return generate_shell_to_file(*params, *distortions, Format, comments,
+                                  filename, failure_reason, &progress);
+  }, OnProgress, OnFinished);
+}
+
+TArray<FSliceLayer> UShellGenerator::SliceShell(float layer_height,
+                                               bool find_crossings) {
+  shell_params params;
+  std::vector<distortion_snapshot> distortions;
+  if(!(layer_height > 0.0f)) {
+    UE_LOG(LogTemp, Warning, TEXT("Attempted to slice a shell with a layer height that wasn't positive!"));
+    return TArray<FSliceLayer>();
+  }
+  if(!get_desired_shell(params, distortions)) {
+    UE_LOG(LogTemp, Warning, TEXT("Attempted to slice a shell before BeginGeneratingShell was called!"));
+    return TArray<FSliceLayer>();
+  }
+  auto curves = params.smoosh();
+  slicing_ring_sink sink(layer_height);
+  if(distortions.empty()) {
+    params.generate(curves, sink);
+  }
+  else {
+    distorting_ring_sink distorting_sink(sink, distortions);
+    params.generate(curves, distorting_sink);
+  }
+  return chain_slices(sink.segments, find_crossings);
+}
+
+namespace {
+  // Adds the edges of the cross section at `linear_theta` to `lines`, laid
+  // out in the plane through the shell's axis at that angle: X is the
+  // distance from the axis, Y the height along it. (This is the same thing
+  // build_shell_at does, minus the rotation around the axis. Any lean of the
+  // cross section along the spiral gets flattened out.)
+  void add_axial_cross_section(TArray<LineSeg>& lines,
+                               const shell_params& params,
+                               const shell_curves& curves,
+                               std::vector<FVector>& temp,
+                               float linear_theta) {
+    float theta = powf_munged(linear_theta, params.theta_exponent);
+    const std::vector<FVector>* curve
+      = params.curve_at(curves.young, curves.old, curves.aperture, temp,
+                        theta);
+    float tube_rad = params.get_tube_normal_radius(theta);
+    float tube_width = params.get_tube_binormal_radius(theta);
+    float spiral_rad = params.get_tube_center_d(linear_theta, theta);
+    auto point = [&](size_t i) {
+      const auto& in = (*curve)[i];
+      return FVector2D(spiral_rad - in.X * tube_rad, in.Y * tube_width);
+    };
+    for(size_t a = 0; a < curve->size(); ++a) {
+      size_t b = a + 1;
+      if(b >= curve->size()) b = 0;
+      lines.Add(LineSeg{point(a), point(b)});
+    }
+  }
+}
+
+TArray<FWhorlOverlap>
+UShellGenerator::ComputeWhorlOverlaps(int samples_per_whorl) {
+  shell_params params;
+  std::vector<distortion_snapshot> distortions;
+  if(samples_per_whorl < 1) {
+    UE_LOG(LogTemp, Warning, TEXT("Attempted to compute whorl overlaps with fewer than one sample per whorl!"));
+    return TArray<FWhorlOverlap>();
+  }
+  if(!get_desired_shell(params, distortions)) {
+    UE_LOG(LogTemp, Warning, TEXT("Attempted to compute whorl overlaps before BeginGeneratingShell was called!"));
+    return TArray<FWhorlOverlap>();
+  }
+  auto curves = params.smoosh();
+  // Work back from the open end, so the newest whorl always gets compared
+  // right at the aperture.
+  float target_age = params.final_age * params.current_age;
+  float spacing = 2.0f / samples_per_whorl;
+  int sample_count = 0;
+  while(target_age - sample_count * spacing - 2.0f >= 0.0f) ++sample_count;
+  TArray<FWhorlOverlap> ret;
+  ret.SetNum(sample_count);
+  ParallelFor(sample_count, [&](int32 n) {
+    auto& overlap = ret[sample_count - 1 - n];
+    overlap.theta = target_age - n * spacing;
+    overlap.previous_theta = overlap.theta - 2.0f;
+    std::vector<FVector> temp;
+    temp.reserve(curves.young.size());
+    TArray<LineSeg> lines;
+    lines.Reserve(curves.young.size() * 2);
+    add_axial_cross_section(lines, params, curves, temp, overlap.theta);
+    add_axial_cross_section(lines, params, curves, temp,
+                            overlap.previous_theta);
+    overlap.crossings = bnlytmn(lines);
+  });
+  return ret;
+}
+
+namespace {
+  std::vector<std::unique_ptr<FMeshDescription>>
+  build_shell_lods(const shell_params& params,
+                   const std::vector<distortion_snapshot>& distortions,
+                   const TArray<FShellLOD>& lods, bool compute_tangents) {
+    std::vector<std::unique_ptr<FMeshDescription>> ret(lods.Num());
+    ParallelFor(lods.Num(), [&](int32 n) {
+      shell_params lod_params = params;
+      lod_params.length_per_iteration *= lods[n].length_multiplier;
+      lod_params.curve_subdivision = lods[n].curve_subdivision;
+      auto curves = lod_params.smoosh();
+      FBakedMesh mesh;
+      lod_params.build_shell(mesh, curves, distortions);
+      ret[n] = make_mesh_description(mesh, compute_tangents);
+    });
+    return ret;
+  }
+
+  UStaticMesh*
+  pack_shell_lods(const std::vector<std::unique_ptr<FMeshDescription>>&
+                  descriptions, const TArray<FShellLOD>& lods) {
+    TArray<const FMeshDescription*> ugh;
+    for(auto& description : descriptions) {
+      if(description == nullptr) return nullptr;
+      ugh.Emplace(description.get());
+    }
+    UStaticMesh* ret = make_static_mesh(ugh);
+    ret->bAutoComputeLODScreenSize = false;
+    for(int n = 0; n < lods.Num(); ++n) {
+      ret->RenderData->ScreenSize[n].Default
+        = n == 0 ? 1.0f : lods[n].screen_size;
+    }
+    return ret;
+  }
+
+  // Keeps the LOD count within what a StaticMesh can hold, and the screen
+  // sizes going down, which is the only order the engine understands.
+  TArray<FShellLOD> checked_lods(const TArray<FShellLOD>& lods) {
+    TArray<FShellLOD> ret;
+    if(lods.Num() <= MAX_STATIC_MESH_LODS) ret = lods;
+    else {
+      UE_LOG(LogTemp, Warning, TEXT("Attempted to build a shell with too many LODs! Only the first %d will be used."), MAX_STATIC_MESH_LODS);
+      ret.Append(lods.GetData(), MAX_STATIC_MESH_LODS);
+    }
+    // (the first LOD's screen size is ignored, so it stays put)
+    auto by_screen_size = [](const FShellLOD& a, const FShellLOD& b) {
+      return a.screen_size > b.screen_size;
+    };
+    if(ret.Num() > 2
+       && !std::is_sorted(ret.GetData() + 1, ret.GetData() + ret.Num(),
+                          by_screen_size)) {
+      UE_LOG(LogTemp, Warning, TEXT("Attempted to build a shell with LOD screen sizes out of order! They will be sorted, biggest first."));
+      std::stable_sort(ret.GetData() + 1, ret.GetData() + ret.Num(),
+                       by_screen_size);
+    }
+    return ret;
+  }
+}
+
+UStaticMesh* UShellGenerator::BuildShellWithLODs(const TArray<FShellLOD>& lods,
+                                                 bool compute_tangents) {
+  shell_params params;
+  std::vector<distortion_snapshot> distortions;
+  if(lods.Num() == 0 || !get_desired_shell(params, distortions))
+    return nullptr;
+  auto used_lods = checked_lods(lods);
+  auto descriptions = build_shell_lods(params, distortions, used_lods,
+                                       compute_tangents);
+  return pack_shell_lods(descriptions, used_lods);
+}
+
+void UShellGenerator::BeginBuildingShellWithLODs(const TArray<FShellLOD>& lods,
+                                                 bool compute_tangents,
+                                                 FStaticMeshReady OnReady) {
+  auto params = std::make_shared<shell_params>();
+  auto distortions = std::make_shared<std::vector<distortion_snapshot>>();
+  if(lods.Num() == 0 || !get_desired_shell(*params, *distortions)) {
+    OnReady.ExecuteIfBound(nullptr);
+    return;
+  }
+  auto used_lods = checked_lods(lods);
+  Async(EAsyncExecution::ThreadPool, [params, distortions, used_lods,
+                                      compute_tangents, OnReady]() {
+    auto descriptions
+      = std::make_shared<std::vector<std::unique_ptr<FMeshDescription>>>
+      (build_shell_lods(*params, *distortions, used_lods, compute_tangents));
+    AsyncTask(ENamedThreads::GameThread, [descriptions, used_lods,
+                                          OnReady]() {
+      OnReady.ExecuteIfBound(pack_shell_lods(*descriptions, used_lods));
+    });
+  });
 }
 
 std::vector<FVector2D> Curve::evaluate(int max_depth) const {
@@ -441,13 +805,15 @@ std::vector<FVector2D> Curve::evaluate(int max_depth) const {
   return ret;
 }
 
-void shell_params::point_at(FBakedMesh& mesh, float theta) const {
+void shell_params::point_at(std::vector<FVector>& positions,
+                            std::vector<FVector2D>& texcoords,
+                            float theta) const {
   float spiral_rad = get_tube_center_d(theta, powf_munged(theta, theta_exponent));
   float theta_radians = theta * -PI;
   float c = cos(theta_radians);
   float s = sin(theta_radians);
-  mesh.vertices->emplace_back(spiral_rad * c, spiral_rad * s, 0.f);
-  mesh.texcoords->emplace_back(theta, 1);
+  positions.emplace_back(spiral_rad * c, spiral_rad * s, 0.f);
+  texcoords.emplace_back(theta, 1);
 }
 
 const std::vector<FVector>*
@@ -486,7 +852,8 @@ shell_params::curve_at(const std::vector<FVector>& young_curve,
 }
 
 
-void shell_params::build_shell_at(FBakedMesh& mesh,
+void shell_params::build_shell_at(std::vector<FVector>& positions,
+                                  std::vector<FVector2D>& texcoords,
 				  const std::vector<FVector>& young_curve,
 				  const std::vector<FVector>& old_curve,
                                   const std::vector<FVector>& aperture_curve,
@@ -509,52 +876,13 @@ void shell_params::build_shell_at(FBakedMesh& mesh,
   float v_mul = 1.f / (curve->size() / 2);
   for(unsigned int i = 0; i < curve->size(); ++i) {
     const auto& in = (*curve)[i];
-    mesh.vertices->emplace_back((in | transform_x) + xplus,
-				(in | transform_y) + yplus,
-				in | transform_z);
+    positions.emplace_back((in | transform_x) + xplus,
+                           (in | transform_y) + yplus,
+                           in | transform_z);
     float v = i * v_mul;
     if(v > 1.f) v -= 2.f; // not >=
-    mesh.texcoords->emplace_back(linear_theta, v);
-  }
-}
-
-void bg_gen_state::attach_shell_segment(FBakedMesh& mesh, bool is_full, unsigned int num_points) {
-  auto& vertices = *mesh.vertices;
-  auto& indices = *mesh.indices;
-  if(!first_segment_attached) {
-    first_segment_attached = true;
-  }
-  else {
-    assert(is_full || last_segment_is_full);
-    if(is_full && last_segment_is_full) {
-      for(unsigned int i = 0; i < num_points; ++i) {
-        int next_i = (i+1) % num_points;
-        indices.push_back(vertices.size() - num_points * 2 + i);
-        indices.push_back(vertices.size() - num_points * 2 + next_i);
-        indices.push_back(vertices.size() - num_points + next_i);
-        indices.push_back(vertices.size() - num_points * 2 + i);
-        indices.push_back(vertices.size() - num_points + next_i);
-        indices.push_back(vertices.size() - num_points + i);
-      }
-    }
-    else if(is_full) {
-      for(unsigned int i = 0; i < num_points; ++i) {
-        int next_i = (i+1) % num_points;
-        indices.push_back(vertices.size() - num_points - 1);
-        indices.push_back(vertices.size() - num_points + next_i);
-        indices.push_back(vertices.size() - num_points + i);
-      }
-    }
-    else if(last_segment_is_full) {
-      for(unsigned int i = 0; i < num_points; ++i) {
-        int next_i = (i+1) % num_points;
-        indices.push_back(vertices.size() - num_points - 1 + i);
-        indices.push_back(vertices.size() - num_points - 1 + next_i);
-        indices.push_back(vertices.size() - 1);
-      }
-    }
+    texcoords.emplace_back(linear_theta, v);
   }
-  last_segment_is_full = is_full;
 }
 
 float shell_params::get_tube_normal_radius(float theta) const {
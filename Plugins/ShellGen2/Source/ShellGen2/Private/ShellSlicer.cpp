@@ -0,0 +1,126 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ShellSlicer.h"
+#include "cook_path.h"
+#include "fast_format.h"
+#include "shell_slicer.h"
+
+#include <algorithm>
+
+TArray<FSliceLayer> UShellSlicer::SliceMesh(const FBakedMesh& mesh,
+                                            float layer_height,
+                                            bool find_crossings) {
+  if(!(layer_height > 0.0f)) {
+    UE_LOG(LogTemp, Warning, TEXT("Attempted to slice a mesh with a layer height that wasn't positive!"));
+    return TArray<FSliceLayer>();
+  }
+  return slice_mesh(mesh, layer_height, find_crossings);
+}
+
+static void output_svg_point(std::string& o, const FVector2D& point) {
+  // SVG's Y goes down the page.
+  append_float(o, point.X);
+  o += ' ';
+  append_float(o, -point.Y);
+}
+
+void UShellSlicer::OutputSlicesSvgFile(const TArray<FString>& comments,
+                                       const TArray<FSliceLayer>& layers,
+                                       const FString& filename,
+                                       bool& saving_succeeded,
+                                       FString& failure_reason) {
+  failure_reason = "";
+  saving_succeeded = false;
+  IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+  FString path = shellgen_cook_path(filename);
+  if(!path.EndsWith(FString(".svg"))) path += ".svg";
+  std::unique_ptr<IFileHandle> file(PlatformFile.OpenWrite(*path));
+  if(!file) {
+    failure_reason = "Unable to write file";
+    return;
+  }
+  bool any = false;
+  FVector2D min(0.0f, 0.0f), max(0.0f, 0.0f);
+  for(auto& layer : layers) {
+    for(auto& contour : layer.contours) {
+      for(auto& point : contour.points) {
+        if(!any) {
+          min = max = point;
+          any = true;
+        }
+        min.X = std::min(min.X, point.X);
+        min.Y = std::min(min.Y, point.Y);
+        max.X = std::max(max.X, point.X);
+        max.Y = std::max(max.Y, point.Y);
+      }
+    }
+  }
+  buffered_file_writer o(*file);
+  std::string out;
+  out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+  for(auto& comment : comments) {
+    // "--" isn't allowed inside an XML comment.
+    std::string text = TCHAR_TO_UTF8(*comment.Replace(TEXT("--"),
+                                                      TEXT("- -")));
+    out += "<!-- ";
+    out += text;
+    out += " -->\n";
+  }
+  out += "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"";
+  append_float(out, min.X);
+  out += ' ';
+  append_float(out, -max.Y);
+  out += ' ';
+  append_float(out, max.X - min.X);
+  out += ' ';
+  append_float(out, max.Y - min.Y);
+  out += "\">\n";
+  for(int n = 0; n < layers.Num(); ++n) {
+    auto& layer = layers[n];
+    out += "<g id=\"layer";
+    append_uint(out, n);
+    out += "\" data-z=\"";
+    append_float(out, layer.z);
+    out += "\">\n";
+    for(auto& contour : layer.contours) {
+      if(contour.points.Num() == 0) continue;
+      out += "<path fill=\"none\" stroke=\"black\" "
+        "vector-effect=\"non-scaling-stroke\" d=\"M";
+      for(int i = 0; i < contour.points.Num(); ++i) {
+        if(i != 0) out += " L";
+        output_svg_point(out, contour.points[i]);
+      }
+      if(contour.closed) out += " Z";
+      out += "\"/>\n";
+    }
+    out += "</g>\n";
+    o.write(out);
+    out.clear();
+  }
+  out += "</svg>\n";
+  o.write(out);
+  saving_succeeded = o.flush();
+  file = nullptr;
+  if(!saving_succeeded) {
+    failure_reason = "Unable to write file";
+    PlatformFile.DeleteFile(*path);
+  }
+}
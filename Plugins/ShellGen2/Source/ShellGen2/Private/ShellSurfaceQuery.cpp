@@ -0,0 +1,111 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ShellSurfaceQuery.h"
+#include "shell_bvh.h"
+
+#include "Async/ParallelFor.h"
+
+namespace {
+  // Fills in the rest of `out` from where `found` landed.
+  void describe_hit(const shell_bvh& bvh, const shell_bvh::hit& found,
+                    FShellSurfaceHit& out) {
+    uint32_t t = found.triangle;
+    const FVector& a = bvh.corner(t, 0);
+    const FVector& b = bvh.corner(t, 1);
+    const FVector& c = bvh.corner(t, 2);
+    out.hit = true;
+    out.position = found.position;
+    out.distance = found.distance;
+    out.triangle = t;
+    // Same winding as calculate_normals.
+    out.normal = FVector::CrossProduct(b - a, c - a).GetSafeNormal();
+    const auto& texcoords = *bvh.mesh.texcoords;
+    FVector2D uv[3];
+    for(int i = 0; i < 3; ++i) uv[i] = texcoords[bvh.index(t, i)];
+    // V jumps from 1 to -1 halfway around each ring (see build_shell_at).
+    // A triangle straddling the jump needs its -1 side moved up to 1 before
+    // blending, and the answer moved back down after.
+    float low = FMath::Min3(uv[0].Y, uv[1].Y, uv[2].Y);
+    float high = FMath::Max3(uv[0].Y, uv[1].Y, uv[2].Y);
+    bool straddles = high - low > 1.0f;
+    if(straddles) {
+      for(auto& corner : uv) if(corner.Y < 0.0f) corner.Y += 2.0f;
+    }
+    float b0 = 1.0f - found.b1 - found.b2;
+    FVector2D blended = uv[0] * b0 + uv[1] * found.b1 + uv[2] * found.b2;
+    if(straddles && blended.Y > 1.0f) blended.Y -= 2.0f;
+    out.theta = blended.X;
+    out.v = blended.Y;
+  }
+}
+
+UShellSurfaceQuery* UShellSurfaceQuery::MakeShellSurfaceQuery
+(const FBakedMesh& mesh) {
+  auto ret = NewObject<UShellSurfaceQuery>();
+  if(mesh.vertices == nullptr) {
+    UE_LOG(LogTemp, Warning, TEXT("Attempted to make a surface query from a nulled-out BakedMesh!"));
+    return ret;
+  }
+  ret->bvh = std::make_shared<const shell_bvh>(mesh);
+  return ret;
+}
+
+TArray<FShellSurfaceHit>
+UShellSurfaceQuery::RayCast(const TArray<FVector>& origins,
+                            const TArray<FVector>& directions,
+                            float max_distance) const {
+  TArray<FShellSurfaceHit> ret;
+  if(origins.Num() != directions.Num()) {
+    UE_LOG(LogTemp, Warning, TEXT("Attempted to cast rays with different numbers of origins and directions!"));
+    return ret;
+  }
+  ret.SetNum(origins.Num());
+  if(bvh == nullptr) return ret;
+  if(!(max_distance > 0.0f)) max_distance = TNumericLimits<float>::Max();
+  const shell_bvh& tree = *bvh;
+  ParallelFor(origins.Num(), [&](int32 n) {
+    FVector direction = directions[n].GetSafeNormal();
+    if(direction.IsZero()) return;
+    shell_bvh::hit found;
+    if(tree.ray_cast(origins[n], direction, max_distance, found)) {
+      describe_hit(tree, found, ret[n]);
+    }
+  });
+  return ret;
+}
+
+TArray<FShellSurfaceHit>
+UShellSurfaceQuery::ClosestPoints(const TArray<FVector>& points,
+                                  float max_distance) const {
+  TArray<FShellSurfaceHit> ret;
+  ret.SetNum(points.Num());
+  if(bvh == nullptr) return ret;
+  // (Squared on the way in, so keep it from overflowing.)
+  if(!(max_distance > 0.0f)) max_distance = 1e18f;
+  const shell_bvh& tree = *bvh;
+  ParallelFor(points.Num(), [&](int32 n) {
+    shell_bvh::hit found;
+    if(tree.closest_point(points[n], max_distance, found)) {
+      describe_hit(tree, found, ret[n]);
+    }
+  });
+  return ret;
+}
@@ -0,0 +1,44 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/AssetUserData.h"
+#include "BakedMesh.h"
+#include "ShellTopologyUserData.generated.h"
+
+/**
+ * Stuck onto the StaticMeshes we make, so that UpdateStaticMeshComponent can
+ * tell whether a new BakedMesh has the same triangles as the old one (and so
+ * only its vertices need replacing).
+ */
+UCLASS()
+class UShellTopologyUserData : public UAssetUserData {
+  GENERATED_BODY()
+public:
+  uint64 vertex_count = 0;
+  uint64 index_count = 0;
+  uint32 index_crc = 0;
+  /** True if `mesh` has exactly the same vertex count and triangles. */
+  bool matches(const FBakedMesh& mesh) const;
+  /** Make this describe `mesh`. */
+  void remember(const FBakedMesh& mesh);
+};
@@ -18,8 +18,15 @@
  */
 
 #include "StlWriter.h"
+#include "cook_path.h"
+#include "fast_format.h"
+#include "mesh_export.h"
+#include "stl_format.h"
 
-#include <sstream>
+#include <cstring>
+
+// This many triangles get encoded together by one worker. (About 3MiB.)
+static constexpr size_t STL_CHUNK_SIZE = 65536;
 
 template<class T> static inline T maybe_swap(T in) {
   if(!PLATFORM_LITTLE_ENDIAN)
@@ -28,22 +35,27 @@ template<class T> static inline T maybe_swap(T in) {
     return in;
 }
 
-static FString cook_path_2(const FString& filename) {
-  return FPaths::ProjectContentDir() + TEXT("/") + filename;
+static void output_ascii_vec(std::string& o, const FVector& in) {
+  append_float(o, in.X);
+  o += ' ';
+  append_float(o, in.Y);
+  o += ' ';
+  append_float(o, in.Z);
+  o += '\n';
 }
 
-static void output_ascii_vertex(std::ostringstream& o, const FVector& in,
+static void output_ascii_vertex(std::string& o, const FVector& in,
 				const FTransform* transform) {
+  o += "        vertex ";
   if(transform != nullptr) {
-    FVector out = TransformVector(*transform, in);
-    o << "        vertex " << out.X << " " << out.Y << " " << out.Z << "\n";
+    output_ascii_vec(o, TransformVector(*transform, in));
   }
   else {
-    o << "        vertex " << in.X << " " << in.Y << " " << in.Z << "\n";
+    output_ascii_vec(o, in);
   }
 }
 
-static void output_binary_vec(std::ostringstream& o, const FVector& in,
+static void output_binary_vec(char*& p, const FVector& in,
 			      const FTransform* transform) {
   FVector out;
   if(transform != nullptr) {
@@ -55,86 +67,90 @@ static void output_binary_vec(std::ostringstream& o, const FVector& in,
   out.X = maybe_swap(out.X);
   out.Y = maybe_swap(out.Y);
   out.Z = maybe_swap(out.Z);
-  o.write(reinterpret_cast<char*>(&out), 12);
+  memcpy(p, &out.X, 4);
+  memcpy(p + 4, &out.Y, 4);
+  memcpy(p + 8, &out.Z, 4);
+  p += 12;
 }
 
-void UStlWriter::OutputAsciiStlFile(const TArray<FString>& comments,
-				    const TArray<FBakedMesh>& meshes,
-				    const TArray<FTransform>& transforms,
-				    const FString& filename,
-				    bool& saving_succeeded,
-				    FString& failure_reason) {
-  failure_reason = "";
-  saving_succeeded = false;
-  std::ostringstream o;
-  o << "solid GeneratedShell";
+static FVector face_normal(const FVector& a, const FVector& b,
+                           const FVector& c, const FTransform* transform) {
+  auto d = b-a;
+  auto e = c-a;
+  auto n = FVector::CrossProduct(d, e);
+  if(transform != nullptr) {
+    FVector transformed = TransformVector(*transform, FVector4(n.X, n.Y, n.Z, 0.0f));
+    n.X = transformed.X;
+    n.Y = transformed.Y;
+    n.Z = transformed.Z;
+  }
+  return n;
+}
+
+void append_ascii_stl_facet(std::string& out, const FVector& a,
+                            const FVector& b, const FVector& c,
+                            const FTransform* transform) {
+  out += "facet normal ";
+  output_ascii_vec(out, face_normal(a, b, c, transform));
+  out += "    outer loop\n";
+  output_ascii_vertex(out, a, transform);
+  output_ascii_vertex(out, b, transform);
+  output_ascii_vertex(out, c, transform);
+  out += "    endloop\n";
+  out += "endfacet\n";
+}
+
+void encode_binary_stl_record(char*& p, const FVector& a, const FVector& b,
+                              const FVector& c, const FTransform* transform) {
+  output_binary_vec(p, face_normal(a, b, c, transform), nullptr);
+  output_binary_vec(p, a, transform);
+  output_binary_vec(p, b, transform);
+  output_binary_vec(p, c, transform);
+  *p++ = 0;
+  *p++ = 0;
+}
+
+std::string ascii_stl_header(const TArray<FString>& comments) {
+  std::string header = "solid GeneratedShell";
   for(auto& comment : comments) {
     auto str = std::string(TCHAR_TO_UTF8(*comment));
     auto p = str.cbegin();
-    o << " || ";
+    header += " || ";
     while(p != str.cend() && *p == ' ') ++p;
     while(p != str.cend()) {
       if(*p == '\r') ++p;
-      else if(*p == '\n') { o << " | "; ++p; }
-      else o << *p++;
+      else if(*p == '\n') { header += " | "; ++p; }
+      else header += *p++;
     }
   }
-  o << "\n\n";
-  for(int m = 0; m < meshes.Num(); ++m) {
-    auto& mesh = meshes[m];
-    if(!mesh.vertices) {
-      failure_reason = "A mesh was NULL";
-      return;
-    }
-    if(!mesh.indices) {
-      failure_reason = "A mesh had null indices";
-      return;
-    }
-    if(!mesh.texcoords) {
-      failure_reason = "A mesh had null texcoords";
-      return;
-    }
-    auto& vertices = *mesh.vertices;
-    auto& indices = *mesh.indices;
-    auto& texcoords = *mesh.texcoords;
-    auto transform = m < transforms.Num() ? &transforms[m] : nullptr;
-    for(auto it = indices.cbegin(); it != indices.cend();) {
-      auto a_index = *it++;
-      auto b_index = *it++;
-      auto c_index = *it++;
-      auto& a = vertices[a_index];
-      auto& b = vertices[b_index];
-      auto& c = vertices[c_index];
-      auto d = b-a;
-      auto e = c-a;
-      auto n = FVector::CrossProduct(d, e);
-      if(transform != nullptr) {
-	FVector transformed = TransformVector(*transform, FVector4(n.X, n.Y, n.Z, 0.0f));
-	n.X = transformed.X;
-	n.Y = transformed.Y;
-	n.Z = transformed.Z;
-      }
-      o << "facet normal " << n.X << " " << n.Y << " " << n.Z << "\n";
-      o << "    outer loop\n";
-      output_ascii_vertex(o, a, transform);
-      output_ascii_vertex(o, b, transform);
-      output_ascii_vertex(o, c, transform);
-      o << "    endloop\n";
-      o << "endfacet\n";
-    }
-  }
-  o << "\nendsolid GeneratedShell\n";
-  auto all = o.str();
+  header += "\n\n";
+  return header;
+}
+
+std::string binary_stl_header(uint32 num_triangles) {
+  std::string header("BINARY STL FILE - GENERATED BY SHELL SHAPE GENERATOR                            ", 80);
+  uint32 count = maybe_swap(num_triangles);
+  header.append(reinterpret_cast<const char*>(&count), 4);
+  return header;
+}
+
+std::unique_ptr<IFileHandle> open_stl_file(const FString& filename,
+                                           FString& path) {
   IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-  FString path = cook_path_2(filename);
+  path = shellgen_cook_path(filename);
   if(!path.EndsWith(FString(".stl"))) path += ".stl";
-  std::unique_ptr<IFileHandle> file(PlatformFile.OpenWrite(*path));
-  if(!file || !file->Write(reinterpret_cast<const uint8_t*>(all.data()),
-                           all.length())) {
-    failure_reason = "Unable to write file";
-    return;
-  }
-  saving_succeeded = true;
+  return std::unique_ptr<IFileHandle>(PlatformFile.OpenWrite(*path));
+}
+
+void UStlWriter::OutputAsciiStlFile(const TArray<FString>& comments,
+				    const TArray<FBakedMesh>& meshes,
+				    const TArray<FTransform>& transforms,
+				    const FString& filename,
+				    bool& saving_succeeded,
+				    FString& failure_reason) {
+  failure_reason = "";
+  saving_succeeded = write_ascii_stl_file(comments, meshes, transforms,
+                                          filename, failure_reason);
 }
 
 void UStlWriter::OutputBinaryStlFile(const TArray<FString>& comments,
@@ -144,70 +160,100 @@ void UStlWriter::OutputBinaryStlFile(const TArray<FString>& comments,
 				     bool& saving_succeeded,
 				     FString& failure_reason) {
   failure_reason = "";
-  saving_succeeded = false;
-  std::ostringstream o;
-  o << "BINARY STL FILE - GENERATED BY SHELL SHAPE GENERATOR                            ";
-  size_t num_triangles = 0;
-  for(int m = 0; m < meshes.Num(); ++m) {
-    auto& mesh = meshes[m];
-    if(!mesh.indices) {
-      failure_reason = "A mesh had null indices";
-      return;
-    }
-    num_triangles += mesh.indices->size() / 3;
+  saving_succeeded = write_binary_stl_file(comments, meshes, transforms,
+                                           filename, failure_reason);
+}
+
+bool write_ascii_stl_file(const TArray<FString>& comments,
+                          const TArray<FBakedMesh>& meshes,
+                          const TArray<FTransform>& transforms,
+                          const FString& filename, FString& failure_reason,
+                          export_progress* progress) {
+  if(!check_export_meshes(meshes, failure_reason)) return false;
+  if(progress) progress->set_total(count_export_triangles(meshes));
+  FString path;
+  auto file = open_stl_file(filename, path);
+  if(!file) {
+    failure_reason = "Unable to write file";
+    return false;
   }
-  num_triangles = maybe_swap(num_triangles);
-  o.write(reinterpret_cast<char*>(&num_triangles), 4);
+  buffered_file_writer o(*file);
+  o.write(ascii_stl_header(comments));
   for(int m = 0; m < meshes.Num(); ++m) {
+    if(progress && progress->is_cancelled()) break;
     auto& mesh = meshes[m];
-    if(!mesh.vertices) {
-      failure_reason = "A mesh was NULL";
-      return;
-    }
-    if(!mesh.indices) {
-      failure_reason = "A mesh had null indices";
-      return;
-    }
-    if(!mesh.texcoords) {
-      failure_reason = "A mesh had null texcoords";
-      return;
-    }
     auto& vertices = *mesh.vertices;
     auto& indices = *mesh.indices;
-    auto& texcoords = *mesh.texcoords;
     auto transform = m < transforms.Num() ? &transforms[m] : nullptr;
-    for(auto it = indices.cbegin(); it != indices.cend();) {
-      auto a_index = *it++;
-      auto b_index = *it++;
-      auto c_index = *it++;
-      auto& a = vertices[a_index];
-      auto& b = vertices[b_index];
-      auto& c = vertices[c_index];
-      auto d = b-a;
-      auto e = c-a;
-      auto n = FVector::CrossProduct(d, e);
-      if(transform != nullptr) {
-	FVector transformed = TransformVector(*transform, FVector4(n.X, n.Y, n.Z, 0.0f));
-	n.X = transformed.X;
-	n.Y = transformed.Y;
-	n.Z = transformed.Z;
-      }
-      output_binary_vec(o, n, nullptr);
-      output_binary_vec(o, a, transform);
-      output_binary_vec(o, b, transform);
-      output_binary_vec(o, c, transform);
-      o.write("\0", 2);
-    }
+    format_chunks_in_order
+      (indices.size() / 3, STL_CHUNK_SIZE,
+       [&](std::string& out, size_t begin, size_t end) {
+         out.reserve((end - begin) * 256);
+         for(size_t n = begin * 3; n < end * 3; n += 3) {
+           auto& a = vertices[indices[n]];
+           auto& b = vertices[indices[n+1]];
+           auto& c = vertices[indices[n+2]];
+           append_ascii_stl_facet(out, a, b, c, transform);
+         }
+       },
+       [&](const std::string& chunk, size_t num_triangles) {
+         if(progress && progress->is_cancelled()) return false;
+         if(!o.write(chunk)) return false;
+         if(progress) progress->advance(num_triangles);
+         return true;
+       });
   }
-  auto all = o.str();
-  IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-  FString path = cook_path_2(filename);
-  if(!path.EndsWith(FString(".stl"))) path += ".stl";
-  std::unique_ptr<IFileHandle> file(PlatformFile.OpenWrite(*path));
-  if(!file || !file->Write(reinterpret_cast<const uint8_t*>(all.data()),
-                           all.length())) {
+  o.write(ASCII_STL_FOOTER);
+  return finish_export_file(file, o, path, progress, failure_reason);
+}
+
+bool write_binary_stl_file(const TArray<FString>& comments,
+                           const TArray<FBakedMesh>& meshes,
+                           const TArray<FTransform>& transforms,
+                           const FString& filename, FString& failure_reason,
+                           export_progress* progress) {
+  if(!check_export_meshes(meshes, failure_reason)) return false;
+  uint64 num_triangles = count_export_triangles(meshes);
+  // The count is only 32 bits, and there's nowhere else to put it.
+  if(num_triangles > 0xFFFFFFFFu) {
+    failure_reason = "Too many triangles for a binary STL file";
+    return false;
+  }
+  if(progress) progress->set_total(num_triangles);
+  FString path;
+  auto file = open_stl_file(filename, path);
+  if(!file) {
     failure_reason = "Unable to write file";
-    return;
+    return false;
+  }
+  buffered_file_writer o(*file);
+  o.write(binary_stl_header(static_cast<uint32>(num_triangles)));
+  for(int m = 0; m < meshes.Num(); ++m) {
+    if(progress && progress->is_cancelled()) break;
+    auto& mesh = meshes[m];
+    auto& vertices = *mesh.vertices;
+    auto& indices = *mesh.indices;
+    auto transform = m < transforms.Num() ? &transforms[m] : nullptr;
+    // Every record is exactly 50 bytes, so each worker knows exactly how
+    // much room it needs before it starts.
+    format_chunks_in_order
+      (indices.size() / 3, STL_CHUNK_SIZE,
+       [&](std::string& out, size_t begin, size_t end) {
+         out.resize((end - begin) * STL_RECORD_SIZE);
+         char* p = &out[0];
+         for(size_t n = begin * 3; n < end * 3; n += 3) {
+           auto& a = vertices[indices[n]];
+           auto& b = vertices[indices[n+1]];
+           auto& c = vertices[indices[n+2]];
+           encode_binary_stl_record(p, a, b, c, transform);
+         }
+       },
+       [&](const std::string& chunk, size_t num_triangles) {
+         if(progress && progress->is_cancelled()) return false;
+         if(!o.write(chunk)) return false;
+         if(progress) progress->advance(num_triangles);
+         return true;
+       });
   }
-  saving_succeeded = true;
+  return finish_export_file(file, o, path, progress, failure_reason);
 }
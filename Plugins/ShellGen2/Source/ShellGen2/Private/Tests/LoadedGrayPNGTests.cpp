@@ -0,0 +1,80 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "loaded_gray_png.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace {
+  // A map full of noise, without going anywhere near a PNG.
+  std::shared_ptr<loaded_gray_png> make_noise_map(uint32_t width,
+                                                  uint32_t height) {
+    auto ret = std::make_shared<loaded_gray_png>();
+    std::shared_ptr<uint8_t> pixels
+      (new uint8_t[width * height + loaded_gray_png::PIXEL_PADDING](),
+       std::default_delete<uint8_t[]>());
+    FRandomStream random(1234);
+    for(uint32_t n = 0; n < width * height; ++n)
+      pixels.get()[n] = uint8_t(random.RandRange(0, 255));
+    ret->width = width;
+    ret->height = height;
+    ret->pixels = pixels.get();
+    ret->storage = std::move(pixels);
+    ret->finish_loading();
+    return ret;
+  }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGrayPNGSampleManyTest,
+                                 "ShellGen2.LoadedGrayPNG.SampleMany",
+                                 EAutomationTestFlags::EditorContext
+                                 | EAutomationTestFlags::EngineFilter)
+
+bool FGrayPNGSampleManyTest::RunTest(const FString& Parameters) {
+  // Power of two (the SIMD path, where the CPU has it) and not (the
+  // fallback). Odd counts leave some points for the scalar tail.
+  const uint32_t sizes[][2] = {{64, 32}, {37, 19}};
+  for(const auto& size : sizes) {
+    auto map = make_noise_map(size[0], size[1]);
+    const size_t count = 1003;
+    std::vector<float> us(count), vs(count), out(count);
+    FRandomStream random(5678);
+    for(size_t n = 0; n < count; ++n) {
+      us[n] = random.FRandRange(-300.0f, 300.0f);
+      vs[n] = random.FRandRange(-300.0f, 300.0f);
+    }
+    for(bool mirror_v : {false, true}) {
+      map->sample_many(us.data(), vs.data(), out.data(), count, mirror_v);
+      for(size_t n = 0; n < count; ++n) {
+        float v = mirror_v && vs[n] < 0.0f ? -vs[n] : vs[n];
+        float expected = map->sample(us[n], v);
+        if(out[n] != expected) {
+          AddError(FString::Printf(TEXT("%ux%u map, point %d: sample_many gave %f, sample gave %f"), size[0], size[1], int(n), out[n], expected));
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "MeshOptimizationLib.h"
+#include "shell_test_util.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimplifyReorderedShellTest,
+                                 "ShellGen2.MeshSimplify.ReorderedShell",
+                                 EAutomationTestFlags::EditorContext
+                                 | EAutomationTestFlags::EngineFilter)
+
+bool FSimplifyReorderedShellTest::RunTest(const FString& Parameters) {
+  UShellGenerator* generator = UShellGenerator::MakeShellGenerator();
+  begin_test_shell(generator);
+  TArray<FRadiusInfo> radius_info;
+  FBakedMesh shell = generator->BlockForGeneratedShell(radius_info);
+  if(!TestNotNull(TEXT("The shell was generated"), shell.vertices.get()))
+    return false;
+  // After this, the vertices are in whatever order the GPU likes, not ring
+  // by ring.
+  FVertexCacheStats before, after;
+  FBakedMesh reordered = UMeshOptimizationLib::OptimizeMeshForRendering
+    (shell, before, after);
+  int32 triangles = int32(reordered.indices->size() / 3);
+  int32 target = triangles / 2;
+  FBakedMesh simplified = UMeshOptimizationLib::SimplifyMesh(reordered,
+                                                             target);
+  int32 remaining = int32(simplified.indices->size() / 3);
+  TestTrue(FString::Printf(TEXT("Simplified %d triangles to %d (target %d)"),
+                           triangles, remaining, target),
+           remaining <= target);
+  return true;
+}
+
+#endif
@@ -0,0 +1,57 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "shell_test_util.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStreamedGlbExportTest,
+                                 "ShellGen2.StreamingExport.Glb",
+                                 EAutomationTestFlags::EditorContext
+                                 | EAutomationTestFlags::EngineFilter)
+
+bool FStreamedGlbExportTest::RunTest(const FString& Parameters) {
+  UShellGenerator* generator = UShellGenerator::MakeShellGenerator();
+  begin_test_shell(generator);
+  const FString filename = TEXT("ShellGen2Tests/streamed_shell");
+  // Where the export is supposed to end up (see shellgen_cook_path).
+  const FString expected = FPaths::ProjectContentDir() + TEXT("/")
+    + filename + TEXT(".glb");
+  IFileManager& files = IFileManager::Get();
+  files.Delete(*expected);
+  bool succeeded = false;
+  FString failure_reason;
+  generator->GenerateShellToFile(ShellExportFormat::ExportGlb,
+                                 TArray<FString>(), filename, succeeded,
+                                 failure_reason);
+  TestTrue(FString::Printf(TEXT("Export succeeded (%s)"), *failure_reason),
+           succeeded);
+  TestTrue(TEXT("The .glb is where it was asked for"),
+           files.FileExists(*expected));
+  TestTrue(TEXT("The .glb isn't empty"), files.FileSize(*expected) > 0);
+  files.Delete(*expected);
+  return true;
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShellGenerator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Start `generator` on a small, plain shell (a round tube, a few whorls,
+ * pointy at both ends), for tests that need a real one.
+ */
+inline void begin_test_shell(UShellGenerator* generator,
+                             int curve_subdivision = 2,
+                             float length_per_iteration = 0.1f) {
+  // Half a circle; the generator mirrors it for the other half.
+  TArray<FCurveNode> cross;
+  auto node = [](FVector2D anchor, FVector2D control) {
+    FCurveNode ret;
+    ret.anchor = anchor;
+    ret.control = control;
+    ret.virtual_proportion = 1.0f;
+    return ret;
+  };
+  cross.Add(node(FVector2D(-1.0f, 0.0f), FVector2D(-1.0f, 0.55f)));
+  cross.Add(node(FVector2D(0.0f, 1.0f), FVector2D(0.55f, 1.0f)));
+  cross.Add(node(FVector2D(1.0f, 0.0f), FVector2D(1.0f, -0.55f)));
+  // A straight grain, which leaves the cross section alone.
+  TArray<FCurveNode> grain;
+  grain.Add(node(FVector2D(0.0f, 0.0f), FVector2D(0.5f, 0.5f)));
+  grain.Add(node(FVector2D(1.0f, 1.0f), FVector2D(1.5f, 1.5f)));
+  TArray<FVector2D> young_endcaps, old_endcaps;
+  young_endcaps.Add(FVector2D(-0.5f, 0.0f));
+  young_endcaps.Add(FVector2D(0.0f, 1.0f));
+  old_endcaps.Add(FVector2D(0.0f, 1.0f));
+  old_endcaps.Add(FVector2D(0.5f, 0.0f));
+  generator->BeginGeneratingShell
+    (1.0f, 1.0f, 0.5f, cross, grain, 0.1f, 0.1f, 0.1f, 1.0f, 2.0f,
+     cross, grain, 0.1f, 0.1f, 0.1f, 5.0f, 6.0f,
+     cross, grain, 0.1f, 0.1f, 0.1f, 1.0f, 8.0f,
+     young_endcaps, old_endcaps, TArray<float>(), length_per_iteration,
+     curve_subdivision);
+}
+
+#endif
@@ -0,0 +1,275 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ThreeMFWriter.h"
+#include "cook_path.h"
+#include "fast_format.h"
+#include "mesh_export.h"
+#include "zip_writer.h"
+#include "three_mf_format.h"
+
+#include <vector>
+
+// This many vertices (or triangles) get formatted and deflated together by
+// one worker.
+static constexpr size_t MODEL_CHUNK_SIZE = 32768;
+
+static const char CONTENT_TYPES[] =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+  "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+  "<Default Extension=\"model\" ContentType=\"application/vnd.ms-package.3dmanufacturing-3dmodel+xml\"/>"
+  "</Types>\n";
+
+static const char RELS[] =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+  "<Relationship Target=\"/3D/3dmodel.model\" Id=\"rel0\" Type=\"http://schemas.microsoft.com/3dmanufacturing/2013/01/3dmodel\"/>"
+  "</Relationships>\n";
+
+void UThreeMFWriter::Output3MFFile(const TArray<FString>& comments,
+                                   const TArray<FBakedMesh>& meshes,
+                                   const TArray<FTransform>& transforms,
+                                   const FString& filename,
+                                   bool& saving_succeeded,
+                                   FString& failure_reason) {
+  failure_reason = "";
+  saving_succeeded = write_3mf_file(comments, meshes, transforms, filename,
+                                    failure_reason);
+}
+
+static void append_xml_text(std::string& out, const std::string& in) {
+  for(char c : in) {
+    switch(c) {
+    case '&': out += "&amp;"; break;
+    case '<': out += "&lt;"; break;
+    case '>': out += "&gt;"; break;
+    case '"': out += "&quot;"; break;
+    case '\r': break;
+    default: out += c;
+    }
+  }
+}
+
+struct model_piece { uint32 crc = 0; uint64 size = 0; bool ok = false; };
+
+/**
+ * Formats `count` things into the model XML a chunk at a time, deflating
+ * each chunk on the same worker that formatted it. The CRCs and lengths of
+ * the undeflated text go in `pieces`, by chunk number, for the writing side
+ * to pick up.
+ */
+template<class F> static bool write_model_chunks(zip_writer& zip,
+                                                 size_t count, F&& format,
+                                                 export_progress* progress,
+                                                 bool counts_triangles) {
+  std::vector<model_piece> pieces((count + MODEL_CHUNK_SIZE - 1)
+                                  / MODEL_CHUNK_SIZE);
+  size_t next_piece = 0;
+  return format_chunks_in_order
+    (count, MODEL_CHUNK_SIZE,
+     [&](std::string& out, size_t begin, size_t end) {
+       std::string xml;
+       xml.reserve((end - begin) * 64);
+       format(xml, begin, end);
+       auto& piece = pieces[begin / MODEL_CHUNK_SIZE];
+       piece.size = xml.size();
+       piece.ok = deflate_zip_piece(xml, out, piece.crc);
+     },
+     [&](const std::string& chunk, size_t num_items) {
+       if(progress && progress->is_cancelled()) return false;
+       const auto& piece = pieces[next_piece++];
+       if(!piece.ok) {
+         zip.fail();
+         return false;
+       }
+       if(!zip.write_piece(chunk, piece.crc, piece.size)) return false;
+       if(progress && counts_triangles) progress->advance(num_items);
+       return true;
+     });
+}
+
+std::unique_ptr<IFileHandle> open_3mf_file(const FString& filename,
+                                           FString& path) {
+  IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+  path = shellgen_cook_path(filename);
+  if(!path.EndsWith(FString(".3mf"))) path += ".3mf";
+  return std::unique_ptr<IFileHandle>(PlatformFile.OpenWrite(*path));
+}
+
+void begin_3mf_model(zip_writer& zip, const TArray<FString>& comments) {
+  zip.begin_entry("[Content_Types].xml");
+  zip.write(CONTENT_TYPES);
+  zip.end_entry();
+  zip.begin_entry("_rels/.rels");
+  zip.write(RELS);
+  zip.end_entry();
+  zip.begin_entry("3D/3dmodel.model");
+  std::string xml =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<model unit=\"millimeter\" xml:lang=\"en-US\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\">\n"
+    " <metadata name=\"Application\">Shell Shape Generator 2</metadata>\n";
+  if(comments.Num() != 0) {
+    xml += " <metadata name=\"Description\">";
+    for(int n = 0; n < comments.Num(); ++n) {
+      if(n != 0) xml += '\n';
+      append_xml_text(xml, std::string(TCHAR_TO_UTF8(*comments[n])));
+    }
+    xml += "</metadata>\n";
+  }
+  xml += " <resources>\n";
+  zip.write(xml);
+}
+
+void begin_3mf_object(zip_writer& zip, int object_id, int mesh_number) {
+  std::string xml = "  <object id=\"";
+  append_uint(xml, object_id);
+  xml += "\" name=\"mesh";
+  append_uint(xml, mesh_number);
+  xml += "\" type=\"model\">\n   <mesh>\n    <vertices>\n";
+  zip.write(xml);
+}
+
+void begin_3mf_triangles(zip_writer& zip) {
+  zip.write("    </vertices>\n    <triangles>\n");
+}
+
+void end_3mf_object(zip_writer& zip) {
+  zip.write("    </triangles>\n   </mesh>\n  </object>\n");
+}
+
+void append_3mf_vertex(std::string& out, const FVector& vertex) {
+  out += "     <vertex x=\"";
+  append_float(out, vertex.X);
+  out += "\" y=\"";
+  append_float(out, vertex.Y);
+  out += "\" z=\"";
+  append_float(out, vertex.Z);
+  out += "\"/>\n";
+}
+
+void append_3mf_triangle(std::string& out, uint32 a, uint32 b, uint32 c) {
+  out += "     <triangle v1=\"";
+  append_uint(out, a);
+  out += "\" v2=\"";
+  append_uint(out, b);
+  out += "\" v3=\"";
+  append_uint(out, c);
+  out += "\"/>\n";
+}
+
+void end_3mf_model(zip_writer& zip, const std::vector<int>& object_ids,
+                   const TArray<FTransform>& transforms) {
+  std::string xml = " </resources>\n <build>\n";
+  for(size_t m = 0; m < object_ids.size(); ++m) {
+    if(object_ids[m] == 0) continue;
+    xml += "  <item objectid=\"";
+    append_uint(xml, object_ids[m]);
+    xml += '"';
+    if(m < static_cast<size_t>(transforms.Num())) {
+      // 3MF and Unreal both multiply row vectors on the left, so the top
+      // three columns of the matrix are exactly what 3MF wants.
+      FMatrix matrix = transforms[m].ToMatrixWithScale();
+      xml += " transform=\"";
+      for(int row = 0; row < 4; ++row) {
+        for(int column = 0; column < 3; ++column) {
+          if(row != 0 || column != 0) xml += ' ';
+          append_float(xml, matrix.M[row][column]);
+        }
+      }
+      xml += '"';
+    }
+    xml += "/>\n";
+  }
+  xml += " </build>\n</model>\n";
+  zip.write(xml);
+  zip.end_entry();
+  zip.finish();
+}
+
+bool write_3mf_file(const TArray<FString>& comments,
+                    const TArray<FBakedMesh>& meshes,
+                    const TArray<FTransform>& transforms,
+                    const FString& filename, FString& failure_reason,
+                    export_progress* progress) {
+  if(!check_export_meshes(meshes, failure_reason)) return false;
+  if(progress) progress->set_total(count_export_triangles(meshes));
+  FString path;
+  auto file = open_3mf_file(filename, path);
+  if(!file) {
+    failure_reason = "Unable to write file";
+    return false;
+  }
+  buffered_file_writer o(*file);
+  zip_writer zip(o);
+  begin_3mf_model(zip, comments);
+  // 3MF won't have objects with nothing in them, so those get skipped.
+  std::vector<int> object_ids(meshes.Num(), 0);
+  int next_id = 1;
+  for(int m = 0; m < meshes.Num(); ++m) {
+    if(progress && progress->is_cancelled()) break;
+    const auto& vertices = *meshes[m].vertices;
+    const auto& indices = *meshes[m].indices;
+    size_t num_triangles = indices.size() / 3;
+    if(vertices.empty() || num_triangles == 0) continue;
+    object_ids[m] = next_id++;
+    begin_3mf_object(zip, object_ids[m], m);
+    // The transform goes on the build item, not on every vertex.
+    if(!write_model_chunks(zip, vertices.size(),
+                           [&](std::string& out, size_t begin, size_t end) {
+      for(size_t n = begin; n < end; ++n) {
+        append_3mf_vertex(out, vertices[n]);
+      }
+    }, progress, false)) break;
+    begin_3mf_triangles(zip);
+    if(!write_model_chunks(zip, num_triangles,
+                           [&](std::string& out, size_t begin, size_t end) {
+      for(size_t n = begin * 3; n < end * 3; n += 3) {
+        append_3mf_triangle(out, indices[n], indices[n+1], indices[n+2]);
+      }
+    }, progress, true)) break;
+    end_3mf_object(zip);
+  }
+  // (Cancelled, or couldn't write. Either way, finish_3mf_file sorts it out.)
+  if(!zip.ok() || (progress && progress->is_cancelled()))
+    return finish_3mf_file(zip, file, o, path, progress, failure_reason);
+  end_3mf_model(zip, object_ids, transforms);
+  return finish_3mf_file(zip, file, o, path, progress, failure_reason);
+}
+
+bool finish_3mf_file(const zip_writer& zip, std::unique_ptr<IFileHandle>& file,
+                     buffered_file_writer& o, const FString& path,
+                     export_progress* progress, FString& failure_reason) {
+  if(!zip.ok() && !(progress && progress->is_cancelled())) {
+    file = nullptr;
+    FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+    failure_reason = "Unable to write file";
+    return false;
+  }
+  if(!zip.fits()) {
+    // We can't do anything about it now. Just don't leave a broken file
+    // lying around.
+    file = nullptr;
+    FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+    failure_reason = "Too much data for a 3MF file";
+    return false;
+  }
+  return finish_export_file(file, o, path, progress, failure_reason);
+}
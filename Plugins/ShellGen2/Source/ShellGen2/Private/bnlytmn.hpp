@@ -31,5 +31,9 @@ struct LineSeg {
 };
 
 TArray<FVector2D> bnlytmn(const TArray<LineSeg>& segments);
+// The old version, which tests each segment against everything the sweep line
+// is crossing. Same answers (in a different order) as long as no endpoints
+// touch, much slower on big inputs.
+TArray<FVector2D> bnlytmn_linear(const TArray<LineSeg>& segments);
 
 #endif
@@ -0,0 +1,125 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "fast_format.h"
+
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformMisc.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
+void append_float(std::string& out, float value) {
+  char buf[32];
+#if defined(__cpp_lib_to_chars)
+  auto result = std::to_chars(buf, buf + sizeof(buf), value);
+  out.append(buf, result.ptr);
+#else
+  // No shortest-roundtrip float formatting in this standard library. Try
+  // increasingly precise %g until it reads back right; 9 digits always does.
+  int length = 0;
+  for(int precision = 6; precision <= 9; ++precision) {
+    length = snprintf(buf, sizeof(buf), "%.*g", precision, value);
+    if(strtof(buf, nullptr) == value) break;
+  }
+  // printf's decimal point is the locale's decimal point. OBJ's is not.
+  for(int n = 0; n < length; ++n) {
+    if(buf[n] == ',') buf[n] = '.';
+  }
+  out.append(buf, length);
+#endif
+}
+
+void append_uint(std::string& out, uint64_t value) {
+  char buf[20];
+  char* p = buf + sizeof(buf);
+  do {
+    *--p = '0' + value % 10;
+    value /= 10;
+  } while(value != 0);
+  out.append(p, buf + sizeof(buf));
+}
+
+buffered_file_writer::buffered_file_writer(IFileHandle& file, size_t capacity)
+  : file(file), capacity(capacity) {
+  buffer.reserve(capacity);
+}
+
+bool buffered_file_writer::write(const char* data, size_t length) {
+  if(failed) return false;
+  if(buffer.size() + length > capacity) {
+    if(!flush()) return false;
+    // Too big to be worth copying? Straight to the file it goes.
+    if(length >= capacity) {
+      if(!file.Write(reinterpret_cast<const uint8*>(data), length))
+        failed = true;
+      return !failed;
+    }
+  }
+  buffer.append(data, length);
+  return true;
+}
+
+bool buffered_file_writer::flush() {
+  if(failed) return false;
+  if(!buffer.empty()) {
+    if(!file.Write(reinterpret_cast<const uint8*>(buffer.data()),
+                   buffer.size()))
+      failed = true;
+    buffer.clear();
+  }
+  return !failed;
+}
+
+bool format_chunks_in_order
+(size_t count, size_t chunk_size,
+ const std::function<void(std::string& out, size_t begin, size_t end)>& format,
+ const std::function<bool(const std::string& chunk, size_t num_items)>&
+ write) {
+  if(count == 0) return true;
+  size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+  // One chunk per worker, plus one so the last straggler doesn't leave
+  // everybody else idle quite as often.
+  size_t wave_size = FPlatformMisc::NumberOfCoresIncludingHyperthreads() + 1;
+  std::vector<std::string> chunks(std::min(wave_size, num_chunks));
+  for(size_t wave_start = 0; wave_start < num_chunks;
+      wave_start += chunks.size()) {
+    size_t this_wave = std::min(chunks.size(), num_chunks - wave_start);
+    ParallelFor(this_wave, [&](int32 n) {
+      auto& out = chunks[n];
+      out.clear();
+      size_t begin = (wave_start + n) * chunk_size;
+      size_t end = std::min(begin + chunk_size, count);
+      format(out, begin, end);
+    });
+    for(size_t n = 0; n < this_wave; ++n) {
+      size_t begin = (wave_start + n) * chunk_size;
+      size_t end = std::min(begin + chunk_size, count);
+      if(!write(chunks[n], end - begin)) return false;
+    }
+  }
+  return true;
+}
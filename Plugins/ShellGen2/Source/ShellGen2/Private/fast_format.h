@@ -0,0 +1,73 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class IFileHandle;
+
+// Bits and pieces for writing big text files quickly. std::ostringstream is
+// locale-aware, slow, and wants to hold the entire file in memory at once.
+// None of these things are what we want.
+
+/**
+ * Append the shortest text that reads back as exactly `value`. Always uses
+ * '.' as the decimal point, no matter what the locale thinks.
+ */
+void append_float(std::string& out, float value);
+void append_uint(std::string& out, uint64_t value);
+
+/**
+ * Collects small writes into a fixed-size buffer and passes them on to the
+ * file in big pieces. Once a write fails, every later write (and flush) fails
+ * too, so you only need to check at the end.
+ */
+class buffered_file_writer {
+  IFileHandle& file;
+  std::string buffer;
+  size_t capacity;
+  bool failed = false;
+public:
+  static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+  buffered_file_writer(IFileHandle& file, size_t capacity = DEFAULT_CAPACITY);
+  bool write(const char* data, size_t length);
+  bool write(const std::string& data) { return write(data.data(), data.size()); }
+  bool flush();
+  bool ok() const { return !failed; }
+};
+
+/**
+ * Format `count` things as text, `chunk_size` of them at a time, spread out
+ * over the thread pool. `format` gets an empty string and the [begin, end)
+ * range it's responsible for. Finished chunks are given to `write` in order,
+ * along with how many things are in them. Only a handful of chunks exist at
+ * once, however big `count` is.
+ *
+ * Returns false (and stops early) if `write` ever does.
+ */
+bool format_chunks_in_order
+(size_t count, size_t chunk_size,
+ const std::function<void(std::string& out, size_t begin, size_t end)>& format,
+ const std::function<bool(const std::string& chunk, size_t num_items)>&
+ write);
@@ -0,0 +1,70 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// The parts of writing a .glb that don't care where the data comes from.
+// (GltfWriter.cpp has the details.)
+
+/** Where one mesh's data lives in the BIN chunk. */
+struct glb_mesh_layout {
+  uint64 vertex_count = 0, index_count = 0;
+  uint64 positions_offset = 0, normals_offset = 0, texcoords_offset = 0;
+  uint64 indices_offset = 0;
+  FVector min = FVector(0.0f), max = FVector(0.0f);
+  int first_accessor = -1; // -1 if there's no mesh here (nothing to draw)
+  int mesh_index = -1;
+};
+
+/**
+ * Given the counts in `layout`, decide where its data goes in a BIN chunk
+ * that's currently `bin_length` long. Returns the new length. Empty meshes
+ * get no data (and mesh_index stays -1).
+ */
+uint64 layout_glb_mesh(glb_mesh_layout& layout, bool include_normals,
+                       uint64 bin_length, int& next_accessor, int& next_mesh);
+/**
+ * Each attribute gets its own bufferView and accessor, in this order:
+ * POSITION, (NORMAL,) TEXCOORD_0, indices.
+ */
+std::string build_glb_json(const TArray<FString>& comments,
+                           const std::vector<glb_mesh_layout>& layouts,
+                           const TArray<FTransform>& transforms,
+                           bool include_normals, uint64 bin_length);
+/** Pads the JSON, and makes sure the whole file will fit in a .glb. */
+bool finish_glb_json(std::string& json, uint64 bin_length,
+                     FString& failure_reason);
+/** The file header plus the JSON chunk's header. */
+std::string glb_header(uint32 json_length, uint64 bin_length);
+std::string glb_bin_header(uint64 bin_length);
+/**
+ * glTF requires every NORMAL to be unit length, but calculate_normals leaves
+ * a zero normal where there's no area to go by (like an endcap tip). Points
+ * those straight up, and renormalizes any that have drifted.
+ */
+void make_glb_normals_unit(FVector* normals, size_t count);
+/** Adds the extension to `filename` if needed and puts the result in path. */
+std::unique_ptr<IFileHandle> open_glb_file(const FString& filename,
+                                           FString& path);
@@ -0,0 +1,302 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "CoreMinimal.h"
+#include "loaded_gray_png.h"
+
+// The AVX2 path is compiled whatever the target's baseline is (UE's x64
+// default is SSE2-era), and only taken if the CPU running us has AVX2.
+#if PLATFORM_CPU_X86_FAMILY
+#define SHELLGEN_AVX2_PATH 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC lets any function use any intrinsic.
+#define SHELLGEN_AVX2_FUNCTION
+#else
+#define SHELLGEN_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#else
+#define SHELLGEN_AVX2_PATH 0
+#endif
+
+void loaded_gray_png::finish_loading() {
+  rows = std::unique_ptr<const uint8_t*[]>(new const uint8_t*[height]);
+  for(uint32_t n = 0; n < height; ++n) {
+    rows[n] = pixels + static_cast<size_t>(n) * width;
+  }
+  pow2 = width != 0 && height != 0
+    && (width & (width - 1)) == 0 && (height & (height - 1)) == 0;
+  if(pow2) {
+    width_mask = width - 1;
+    height_mask = height - 1;
+    width_shift = 0;
+    while((1u << width_shift) < width) ++width_shift;
+  }
+  else {
+    width_mask = height_mask = width_shift = 0;
+  }
+}
+
+const std::vector<loaded_gray_png::mip_level>&
+loaded_gray_png::mip_chain() const {
+  std::call_once(mips_built, [this]() { build_mips(); });
+  return mips;
+}
+
+void loaded_gray_png::build_mips() const {
+  mips.clear();
+  size_t levels = 0;
+  for(uint32_t w = width, h = height; w > 1 || h > 1; ++levels) {
+    w = w > 1 ? w / 2 : 1;
+    h = h > 1 ? h / 2 : 1;
+  }
+  // Reserved up front, so `prev` stays put while the next level is added.
+  mips.reserve(levels);
+  uint32_t prev_width = width, prev_height = height;
+  const mip_level* prev = nullptr; // (nullptr: the full size image)
+  auto prev_at = [&](uint32_t x, uint32_t y) {
+    return prev == nullptr ? rows[y][x] : prev->at(x, y);
+  };
+  while(prev_width > 1 || prev_height > 1) {
+    uint32_t w = prev_width > 1 ? prev_width / 2 : 1;
+    uint32_t h = prev_height > 1 ? prev_height / 2 : 1;
+    mips.emplace_back();
+    auto& level = mips.back();
+    level.width = w;
+    level.height = h;
+    level.tiles_across = (w + mip_level::TILE_MASK) >> mip_level::TILE_SHIFT;
+    uint32_t tiles_down = (h + mip_level::TILE_MASK) >> mip_level::TILE_SHIFT;
+    level.texels = std::unique_ptr<uint8_t[]>
+      (new uint8_t[(level.tiles_across * tiles_down)
+                   << (mip_level::TILE_SHIFT * 2)]());
+    for(uint32_t y = 0; y < h; ++y) {
+      for(uint32_t x = 0; x < w; ++x) {
+        // box filter. odd sizes just lose their last row/column, which is
+        // a little sloppy but nobody is going to notice on a bump map.
+        uint32_t x1 = (x * 2) % prev_width, x2 = (x * 2 + 1) % prev_width;
+        uint32_t y1 = (y * 2) % prev_height, y2 = (y * 2 + 1) % prev_height;
+        uint8_t value = static_cast<uint8_t>((prev_at(x1, y1) + prev_at(x2, y1)
+                                              + prev_at(x1, y2)
+                                              + prev_at(x2, y2) + 2) >> 2);
+        uint32_t index = ((((y >> mip_level::TILE_SHIFT) * level.tiles_across)
+                           + (x >> mip_level::TILE_SHIFT))
+                          << (mip_level::TILE_SHIFT * 2))
+          + ((y & mip_level::TILE_MASK) << mip_level::TILE_SHIFT)
+          + (x & mip_level::TILE_MASK);
+        level.texels[index] = value;
+      }
+    }
+    prev = &mips.back();
+    prev_width = w;
+    prev_height = h;
+  }
+}
+
+float loaded_gray_png::mip_level::sample(float u, float v, bool pow2) const {
+  float ufloor = floorf(u);
+  float vfloor = floorf(v);
+  float ufract = u - ufloor;
+  float vfract = v - vfloor;
+  int32_t x = static_cast<int32_t>(ufloor);
+  int32_t y = static_cast<int32_t>(vfloor);
+  uint32_t x1, x2, y1, y2;
+  if(pow2) {
+    x1 = static_cast<uint32_t>(x) & (width - 1);
+    x2 = static_cast<uint32_t>(x + 1) & (width - 1);
+    y1 = static_cast<uint32_t>(y) & (height - 1);
+    y2 = static_cast<uint32_t>(y + 1) & (height - 1);
+  }
+  else {
+    x1 = umod(x, width);
+    x2 = umod(x + 1, width);
+    y1 = umod(y, height);
+    y2 = umod(y + 1, height);
+  }
+  float a = BYTE_TO_FLOAT[at(x1, y1)];
+  float b = BYTE_TO_FLOAT[at(x2, y1)];
+  float c = BYTE_TO_FLOAT[at(x1, y2)];
+  float d = BYTE_TO_FLOAT[at(x2, y2)];
+  float ab = (a * (1.0f - ufract)) + (b * ufract);
+  float cd = (c * (1.0f - ufract)) + (d * ufract);
+  return (ab * (1.0f - vfract)) + (cd * vfract);
+}
+
+float loaded_gray_png::sample_filtered(float u, float v,
+                                       float footprint) const {
+  if(!(footprint > 1.0f)) return sample(u, v);
+  const auto& chain = mip_chain();
+  if(chain.empty()) return sample(u, v);
+  float lod = log2f(footprint);
+  float max_lod = static_cast<float>(chain.size());
+  if(lod >= max_lod) lod = max_lod;
+  size_t level = static_cast<size_t>(lod);
+  float blend = lod - static_cast<float>(level);
+  // Texel centers line up with integer coordinates (that's what the -0.5 in
+  // MakeDistortion is for), so scale about the corner, not the center.
+  auto sample_level = [&](size_t n) {
+    if(n == 0) return sample(u, v);
+    const auto& mip = chain[n - 1];
+    float su = (u + 0.5f) * (static_cast<float>(mip.width) / width) - 0.5f;
+    float sv = (v + 0.5f) * (static_cast<float>(mip.height) / height) - 0.5f;
+    return mip.sample(su, sv, pow2);
+  };
+  float lo = sample_level(level);
+  if(blend <= 0.0f || level >= chain.size()) return lo;
+  float hi = sample_level(level + 1);
+  return lo + (hi - lo) * blend;
+}
+
+void loaded_gray_png::sample_many_filtered(const float* us, const float* vs,
+                                           const float* footprints,
+                                           float* out, size_t count,
+                                           bool mirror_v) const {
+  for(size_t n = 0; n < count; ++n) {
+    float v = vs[n];
+    if(mirror_v && v < 0.0f) v *= -1.0f;
+    out[n] = sample_filtered(us[n], v, footprints[n]);
+  }
+}
+
+namespace {
+  // loaded_gray_png::sample, minus all the division.
+  inline float sample_pow2(const uint8_t* pixels, uint32_t width_mask,
+                           uint32_t height_mask, uint32_t width_shift,
+                           float u, float v) {
+    float ufloor = floorf(u);
+    float vfloor = floorf(v);
+    float ufract = u - ufloor;
+    float vfract = v - vfloor;
+    // two's complement makes the mask do the right thing for negative
+    // coordinates, too
+    uint32_t x = static_cast<uint32_t>(static_cast<int32_t>(ufloor));
+    uint32_t y = static_cast<uint32_t>(static_cast<int32_t>(vfloor));
+    uint32_t x1 = x & width_mask;
+    uint32_t x2 = (x + 1) & width_mask;
+    const uint8_t* row1 = pixels + ((y & height_mask) << width_shift);
+    const uint8_t* row2 = pixels + (((y + 1) & height_mask) << width_shift);
+    float a = BYTE_TO_FLOAT[row1[x1]];
+    float b = BYTE_TO_FLOAT[row1[x2]];
+    float c = BYTE_TO_FLOAT[row2[x1]];
+    float d = BYTE_TO_FLOAT[row2[x2]];
+    float ab = (a * (1.0f - ufract)) + (b * ufract);
+    float cd = (c * (1.0f - ufract)) + (d * ufract);
+    return (ab * (1.0f - vfract)) + (cd * vfract);
+  }
+#if SHELLGEN_AVX2_PATH
+  bool cpu_has_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7) return false;
+    __cpuid(info, 1);
+    // AVX, and the OS saving the YMM registers on context switches
+    if((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+    if((_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    // (checks for OS support, too. The init is needed because this runs
+    // during static initialization.)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+  }
+  const bool HAVE_AVX2 = cpu_has_avx2();
+  // Gather eight texels. Each lane reads four bytes starting at its texel and
+  // keeps only the first one, which is why the pixel buffer has padding.
+  SHELLGEN_AVX2_FUNCTION
+  inline __m256 gather_texels(const int* base, __m256i index) {
+    __m256i raw = _mm256_i32gather_epi32(base, index, 1);
+    raw = _mm256_and_si256(raw, _mm256_set1_epi32(0xFF));
+    // divide rather than multiply by the reciprocal, so that we get exactly
+    // the same values that are in BYTE_TO_FLOAT
+    return _mm256_div_ps(_mm256_cvtepi32_ps(raw), _mm256_set1_ps(255.0f));
+  }
+  SHELLGEN_AVX2_FUNCTION
+  inline __m256 lerp8(__m256 a, __m256 b, __m256 i) {
+    return _mm256_add_ps(_mm256_mul_ps(a, _mm256_sub_ps(_mm256_set1_ps(1.0f),
+                                                        i)),
+                         _mm256_mul_ps(b, i));
+  }
+  // Does as many groups of eight as there are in `count`, and returns how
+  // many points that was.
+  SHELLGEN_AVX2_FUNCTION
+  size_t sample_many_pow2_avx2(const uint8_t* pixels, uint32_t width_mask,
+                               uint32_t height_mask, uint32_t width_shift,
+                               const float* us, const float* vs, float* out,
+                               size_t count, bool mirror_v) {
+    size_t n = 0;
+    const int* base = reinterpret_cast<const int*>(pixels);
+    const __m256i wmask = _mm256_set1_epi32(static_cast<int>(width_mask));
+    const __m256i hmask = _mm256_set1_epi32(static_cast<int>(height_mask));
+    const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(width_shift));
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256 sign_bit = _mm256_set1_ps(-0.0f);
+    for(; n + 8 <= count; n += 8) {
+      __m256 u = _mm256_loadu_ps(us + n);
+      __m256 v = _mm256_loadu_ps(vs + n);
+      if(mirror_v) v = _mm256_andnot_ps(sign_bit, v);
+      __m256 ufloor = _mm256_floor_ps(u);
+      __m256 vfloor = _mm256_floor_ps(v);
+      __m256 ufract = _mm256_sub_ps(u, ufloor);
+      __m256 vfract = _mm256_sub_ps(v, vfloor);
+      __m256i x = _mm256_cvttps_epi32(ufloor);
+      __m256i y = _mm256_cvttps_epi32(vfloor);
+      __m256i x1 = _mm256_and_si256(x, wmask);
+      __m256i x2 = _mm256_and_si256(_mm256_add_epi32(x, one), wmask);
+      __m256i row1 = _mm256_sll_epi32(_mm256_and_si256(y, hmask), shift);
+      __m256i row2 = _mm256_sll_epi32
+        (_mm256_and_si256(_mm256_add_epi32(y, one), hmask), shift);
+      __m256 a = gather_texels(base, _mm256_add_epi32(row1, x1));
+      __m256 b = gather_texels(base, _mm256_add_epi32(row1, x2));
+      __m256 c = gather_texels(base, _mm256_add_epi32(row2, x1));
+      __m256 d = gather_texels(base, _mm256_add_epi32(row2, x2));
+      _mm256_storeu_ps(out + n, lerp8(lerp8(a, b, ufract),
+                                      lerp8(c, d, ufract), vfract));
+    }
+    return n;
+  }
+#endif
+}
+
+void loaded_gray_png::sample_many(const float* us, const float* vs,
+                                  float* out, size_t count, bool mirror_v) {
+  if(!pow2) {
+    for(size_t n = 0; n < count; ++n) {
+      float v = vs[n];
+      if(mirror_v && v < 0.0f) v *= -1.0f;
+      out[n] = sample(us[n], v);
+    }
+    return;
+  }
+  size_t n = 0;
+#if SHELLGEN_AVX2_PATH
+  if(HAVE_AVX2)
+    n = sample_many_pow2_avx2(pixels, width_mask, height_mask, width_shift,
+                              us, vs, out, count, mirror_v);
+#endif
+  const uint8_t* p = pixels;
+  for(; n < count; ++n) {
+    float v = vs[n];
+    if(mirror_v && v < 0.0f) v *= -1.0f;
+    out[n] = sample_pow2(p, width_mask, height_mask, width_shift, us[n], v);
+  }
+}
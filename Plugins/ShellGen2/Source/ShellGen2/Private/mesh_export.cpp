@@ -0,0 +1,63 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "mesh_export.h"
+#include "fast_format.h"
+
+bool check_export_meshes(const TArray<FBakedMesh>& meshes,
+                         FString& failure_reason) {
+  for(int m = 0; m < meshes.Num(); ++m) {
+    auto& mesh = meshes[m];
+    if(!mesh.vertices) {
+      failure_reason = "A mesh was NULL";
+      return false;
+    }
+    if(!mesh.indices) {
+      failure_reason = "A mesh had null indices";
+      return false;
+    }
+    if(!mesh.texcoords) {
+      failure_reason = "A mesh had null texcoords";
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64 count_export_triangles(const TArray<FBakedMesh>& meshes) {
+  uint64 ret = 0;
+  for(int m = 0; m < meshes.Num(); ++m) {
+    if(meshes[m].indices) ret += meshes[m].indices->size() / 3;
+  }
+  return ret;
+}
+
+bool finish_export_file(std::unique_ptr<IFileHandle>& file,
+                        buffered_file_writer& o, const FString& path,
+                        export_progress* progress, FString& failure_reason) {
+  bool cancelled = progress != nullptr && progress->is_cancelled();
+  bool ok = !cancelled && o.flush();
+  file = nullptr; // close it before we (maybe) delete it
+  if(!ok) {
+    failure_reason = cancelled ? "Export was cancelled" : "Unable to write file";
+    FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+  }
+  return ok;
+}
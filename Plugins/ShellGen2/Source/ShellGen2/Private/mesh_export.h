@@ -0,0 +1,98 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include <functional>
+#include "BakedMesh.h"
+
+class buffered_file_writer;
+
+/**
+ * Shared between an export running on some worker thread and whoever is
+ * waiting for it. All the writers below take one of these, but it's always
+ * okay to pass null.
+ */
+struct export_progress {
+  std::atomic<uint64> triangles_written{0};
+  std::atomic<uint64> triangles_total{0};
+  std::atomic<bool> cancelled{false};
+  /**
+   * Called (on the exporting thread) every time some triangles make it to
+   * disk.
+   */
+  std::function<void(uint64 written, uint64 total)> on_progress;
+  bool is_cancelled() const { return cancelled.load(std::memory_order_relaxed); }
+  void set_total(uint64 total) { triangles_total = total; }
+  void advance(uint64 triangles) {
+    uint64 written = triangles_written += triangles;
+    if(on_progress) on_progress(written, triangles_total);
+  }
+};
+
+/*
+ * The actual exporters behind the Blueprint writer functions. These don't
+ * touch any UObjects, so they're safe to run off the game thread. They
+ * return false and fill in failure_reason if something goes wrong, or if
+ * `progress` gets cancelled partway (in which case the partial file is
+ * deleted).
+ */
+bool write_obj_file(const TArray<FString>& comments,
+                    const TArray<FBakedMesh>& meshes,
+                    const TArray<FTransform>& transforms,
+                    const FString& filename, FString& failure_reason,
+                    export_progress* progress = nullptr);
+bool write_ascii_stl_file(const TArray<FString>& comments,
+                          const TArray<FBakedMesh>& meshes,
+                          const TArray<FTransform>& transforms,
+                          const FString& filename, FString& failure_reason,
+                          export_progress* progress = nullptr);
+bool write_binary_stl_file(const TArray<FString>& comments,
+                           const TArray<FBakedMesh>& meshes,
+                           const TArray<FTransform>& transforms,
+                           const FString& filename, FString& failure_reason,
+                           export_progress* progress = nullptr);
+bool write_glb_file(const TArray<FString>& comments,
+                    const TArray<FBakedMesh>& meshes,
+                    const TArray<FTransform>& transforms,
+                    const FString& filename, bool include_normals,
+                    FString& failure_reason,
+                    export_progress* progress = nullptr);
+bool write_3mf_file(const TArray<FString>& comments,
+                    const TArray<FBakedMesh>& meshes,
+                    const TArray<FTransform>& transforms,
+                    const FString& filename, FString& failure_reason,
+                    export_progress* progress = nullptr);
+
+// Bits shared between the writers.
+
+/** Makes sure none of the meshes have null pieces. */
+bool check_export_meshes(const TArray<FBakedMesh>& meshes,
+                         FString& failure_reason);
+uint64 count_export_triangles(const TArray<FBakedMesh>& meshes);
+/**
+ * Flushes and closes `file`. If that fails, or the export was cancelled,
+ * deletes what we wrote of it.
+ */
+bool finish_export_file(std::unique_ptr<IFileHandle>& file,
+                        buffered_file_writer& o, const FString& path,
+                        export_progress* progress, FString& failure_reason);
@@ -0,0 +1,200 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "mesh_optimize.h"
+
+#include <algorithm>
+#include <cmath>
+
+// The cache the optimizer imagines it's feeding. (Bigger than most real
+// ones, which works out better in practice than aiming at any one size.)
+static constexpr int FORSYTH_CACHE_SIZE = 32;
+// Scores for vertices with more triangles left than this are all the same.
+static constexpr unsigned int FORSYTH_MAX_VALENCE = 32;
+
+namespace {
+  struct forsyth_scores {
+    float cache[FORSYTH_CACHE_SIZE];
+    float valence[FORSYTH_MAX_VALENCE + 1];
+    forsyth_scores() {
+      for(int n = 0; n < FORSYTH_CACHE_SIZE; ++n) {
+        if(n < 3) {
+          // The last triangle's vertices. Using them again right away is
+          // good, but it's better to wander off a little and come back, so
+          // the strip doesn't spiral in on itself.
+          cache[n] = 0.75f;
+        }
+        else {
+          float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+          cache[n] = std::pow(1.0f - (n - 3) * scale, 1.5f);
+        }
+      }
+      valence[0] = 0.0f;
+      for(unsigned int n = 1; n <= FORSYTH_MAX_VALENCE; ++n) {
+        // Finishing off vertices with only a few triangles left is good;
+        // it stops lonely triangles from getting stranded.
+        valence[n] = 2.0f / std::sqrt(float(n));
+      }
+    }
+    float score(int cache_position, unsigned int remaining) const {
+      if(remaining == 0) return -1.0f; // nobody will ask for it again
+      float ret = valence[std::min(remaining, FORSYTH_MAX_VALENCE)];
+      if(cache_position >= 0) ret += cache[cache_position];
+      return ret;
+    }
+  };
+}
+
+vertex_cache_stats analyze_vertex_cache(const std::vector<uint32_t>& indices,
+                                        size_t vertex_count,
+                                        unsigned int cache_size) {
+  vertex_cache_stats ret;
+  if(indices.empty()) return ret;
+  // A vertex is in the cache if fewer than cache_size misses have happened
+  // since it last went in.
+  std::vector<uint64> went_in(vertex_count, 0);
+  std::vector<bool> used(vertex_count, false);
+  uint64 misses = 0, unique = 0;
+  for(uint32_t v : indices) {
+    if(!used[v]) {
+      used[v] = true;
+      ++unique;
+    }
+    if(went_in[v] == 0 || misses - went_in[v] >= cache_size) {
+      ++misses;
+      went_in[v] = misses;
+    }
+  }
+  ret.acmr = float(misses) / (indices.size() / 3);
+  ret.atvr = float(misses) / unique;
+  return ret;
+}
+
+std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t>&
+                                            indices, size_t vertex_count) {
+  static const forsyth_scores scores;
+  size_t triangle_count = indices.size() / 3;
+  if(triangle_count == 0) return indices;
+  // Which triangles use each vertex. The first `remaining[v]` entries of a
+  // vertex's list are the ones that haven't been drawn yet.
+  std::vector<uint32_t> remaining(vertex_count, 0);
+  for(uint32_t v : indices) ++remaining[v];
+  std::vector<uint32_t> first_triangle(vertex_count + 1, 0);
+  for(size_t v = 0; v < vertex_count; ++v)
+    first_triangle[v+1] = first_triangle[v] + remaining[v];
+  std::vector<uint32_t> triangles(indices.size());
+  {
+    std::vector<uint32_t> next(first_triangle.begin(),
+                               first_triangle.end() - 1);
+    for(size_t n = 0; n < indices.size(); ++n)
+      triangles[next[indices[n]]++] = n / 3;
+  }
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+  for(size_t v = 0; v < vertex_count; ++v)
+    vertex_score[v] = scores.score(-1, remaining[v]);
+  std::vector<float> triangle_score(triangle_count);
+  std::vector<bool> drawn(triangle_count, false);
+  for(size_t t = 0; t < triangle_count; ++t) {
+    triangle_score[t] = vertex_score[indices[t*3]]
+      + vertex_score[indices[t*3+1]] + vertex_score[indices[t*3+2]];
+  }
+  std::vector<uint32_t> ret;
+  ret.reserve(indices.size());
+  std::vector<uint32_t> cache, new_cache;
+  cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  new_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  // Where to look for a new triangle when nothing in the cache has any left.
+  size_t cursor = 0;
+  int64 best = 0;
+  for(size_t drawn_count = 0; drawn_count < triangle_count; ++drawn_count) {
+    if(best < 0) {
+      while(drawn[cursor]) ++cursor;
+      best = cursor;
+    }
+    drawn[best] = true;
+    const uint32_t* corners = &indices[best*3];
+    new_cache.clear();
+    for(int corner = 0; corner < 3; ++corner) {
+      uint32_t v = corners[corner];
+      ret.push_back(v);
+      new_cache.push_back(v);
+      // Cross this triangle off the vertex's list.
+      uint32_t* list = &triangles[first_triangle[v]];
+      uint32_t* end = list + remaining[v];
+      *std::find(list, end, uint32_t(best)) = end[-1];
+      --remaining[v];
+    }
+    for(uint32_t v : cache) {
+      if(v != corners[0] && v != corners[1] && v != corners[2])
+        new_cache.push_back(v);
+    }
+    // Everything that was, or is now, in the cache gets a new score, and so
+    // do the triangles that use it.
+    best = -1;
+    float best_score = -1.0f;
+    for(size_t n = 0; n < new_cache.size(); ++n) {
+      uint32_t v = new_cache[n];
+      cache_position[v] = n < FORSYTH_CACHE_SIZE ? int(n) : -1;
+      float score = scores.score(cache_position[v], remaining[v]);
+      float delta = score - vertex_score[v];
+      vertex_score[v] = score;
+      const uint32_t* list = &triangles[first_triangle[v]];
+      for(uint32_t i = 0; i < remaining[v]; ++i) {
+        uint32_t t = list[i];
+        triangle_score[t] += delta;
+        if(triangle_score[t] > best_score) {
+          best_score = triangle_score[t];
+          best = t;
+        }
+      }
+    }
+    if(new_cache.size() > FORSYTH_CACHE_SIZE)
+      new_cache.resize(FORSYTH_CACHE_SIZE);
+    std::swap(cache, new_cache);
+  }
+  return ret;
+}
+
+FBakedMesh optimize_vertex_fetch(const FBakedMesh& mesh) {
+  const auto& vertices = *mesh.vertices;
+  const auto& texcoords = *mesh.texcoords;
+  const auto& indices = *mesh.indices;
+  static constexpr uint32_t UNUSED = ~uint32_t(0);
+  std::vector<uint32_t> remap(vertices.size(), UNUSED);
+  uint32_t next = 0;
+  for(uint32_t v : indices) {
+    if(remap[v] == UNUSED) remap[v] = next++;
+  }
+  for(auto& v : remap) {
+    if(v == UNUSED) v = next++;
+  }
+  auto out_vertices = std::make_shared<std::vector<FVector>>(vertices.size());
+  auto out_texcoords
+    = std::make_shared<std::vector<FVector2D>>(texcoords.size());
+  auto out_indices = std::make_shared<std::vector<uint32_t>>(indices.size());
+  for(size_t v = 0; v < vertices.size(); ++v) {
+    (*out_vertices)[remap[v]] = vertices[v];
+    (*out_texcoords)[remap[v]] = texcoords[v];
+  }
+  for(size_t n = 0; n < indices.size(); ++n)
+    (*out_indices)[n] = remap[indices[n]];
+  return FBakedMesh(out_vertices, out_texcoords, out_indices);
+}
@@ -0,0 +1,59 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <vector>
+#include "BakedMesh.h"
+
+// Making meshes cheaper to draw, without changing what they look like.
+
+struct vertex_cache_stats {
+  /** Average cache miss ratio: vertex shader runs per triangle. 0.5 is
+      about as good as it gets; 3 is as bad as it gets. */
+  float acmr = 0.0f;
+  /** Average transform to vertex ratio: vertex shader runs per vertex. 1 is
+      perfect. */
+  float atvr = 0.0f;
+};
+
+/**
+ * How well `indices` would use a FIFO post-transform cache holding
+ * `cache_size` vertices (a reasonable stand-in for real hardware).
+ */
+vertex_cache_stats analyze_vertex_cache(const std::vector<uint32_t>& indices,
+                                        size_t vertex_count,
+                                        unsigned int cache_size = 16);
+
+/**
+ * The same triangles, reordered so that triangles sharing vertices are drawn
+ * close together. (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".)
+ * Each triangle keeps its winding.
+ */
+std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t>&
+                                            indices, size_t vertex_count);
+
+/**
+ * The same mesh, with the vertices renumbered in the order the triangles
+ * first use them, so the vertex fetches walk forward through memory.
+ * Vertices no triangle uses end up at the end.
+ */
+FBakedMesh optimize_vertex_fetch(const FBakedMesh& mesh);
@@ -0,0 +1,366 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "mesh_simplify.h"
+
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformMisc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+// Vertices with more neighbours than this are kept too, in case they're the
+// tip of something that isn't laid out like a shell. (A vertex in the middle
+// of a shell has six.)
+static constexpr size_t APEX_VALENCE = 8;
+// Give up after this many passes in a row that don't collapse anything.
+static constexpr int MAX_IDLE_PASSES = 2;
+
+namespace {
+  /** Sum of squared distances to a bunch of (weighted) planes. */
+  struct quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0,
+      cd = 0, d2 = 0;
+    double weight = 0;
+    void add_plane(double a, double b, double c, double d, double w) {
+      a2 += w*a*a; ab += w*a*b; ac += w*a*c; ad += w*a*d;
+      b2 += w*b*b; bc += w*b*c; bd += w*b*d;
+      c2 += w*c*c; cd += w*c*d;
+      d2 += w*d*d;
+      weight += w;
+    }
+    quadric& operator+=(const quadric& o) {
+      a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+      b2 += o.b2; bc += o.bc; bd += o.bd;
+      c2 += o.c2; cd += o.cd;
+      d2 += o.d2;
+      weight += o.weight;
+      return *this;
+    }
+    /** Mean squared distance from `p` to the planes. */
+    double error(const FVector& p) const {
+      double x = p.X, y = p.Y, z = p.Z;
+      double sum = a2*x*x + 2*ab*x*y + 2*ac*x*z + 2*ad*x
+        + b2*y*y + 2*bc*y*z + 2*bd*y
+        + c2*z*z + 2*cd*z
+        + d2;
+      return weight > 0 ? std::max(sum, 0.0) / weight : 0.0;
+    }
+  };
+
+  struct collapse {
+    double cost;
+    uint32_t from, to;
+    uint32_t from_version, to_version;
+    bool operator>(const collapse& o) const { return cost > o.cost; }
+  };
+  typedef std::priority_queue<collapse, std::vector<collapse>,
+                              std::greater<collapse>> collapse_queue;
+
+  class simplifier {
+    const std::vector<FVector>& positions;
+    const std::vector<FVector2D>& texcoords;
+    double max_error_squared;
+    std::vector<uint32_t> corners;
+    // (uint8, not bool, so different threads can write neighbouring ones)
+    std::vector<uint8> alive, locked, collapsed;
+    std::vector<std::vector<uint32_t>> vertex_triangles;
+    std::vector<quadric> quadrics;
+    std::vector<uint32_t> version;
+    // Which band each vertex belongs to this pass, or -1 if it's on the edge
+    // of one (and so can't be touched).
+    std::vector<int> vertex_band;
+    std::vector<std::vector<uint32_t>> band_triangles;
+    size_t alive_count;
+    bool has(uint32_t t, uint32_t v) const {
+      return corners[t*3] == v || corners[t*3+1] == v || corners[t*3+2] == v;
+    }
+    FVector triangle_normal(uint32_t t, uint32_t replace, uint32_t with) const {
+      FVector p[3];
+      for(int i = 0; i < 3; ++i) {
+        uint32_t v = corners[t*3+i];
+        p[i] = positions[v == replace ? with : v];
+      }
+      return FVector::CrossProduct(p[1] - p[0], p[2] - p[0]);
+    }
+    void neighbours(uint32_t v, std::vector<uint32_t>& out) const {
+      out.clear();
+      for(uint32_t t : vertex_triangles[v]) {
+        if(!alive[t]) continue;
+        for(int i = 0; i < 3; ++i) {
+          uint32_t w = corners[t*3+i];
+          if(w != v) out.push_back(w);
+        }
+      }
+      std::sort(out.begin(), out.end());
+      out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+    bool can_move(int band, uint32_t from, uint32_t to) const {
+      return vertex_band[from] == band && vertex_band[to] == band
+        && !locked[from] && !collapsed[from] && !collapsed[to];
+    }
+    void consider(collapse_queue& queue, int band, uint32_t from, uint32_t to) {
+      if(!can_move(band, from, to)) return;
+      quadric q = quadrics[from];
+      q += quadrics[to];
+      queue.push(collapse{q.error(positions[to]), from, to,
+                          version[from], version[to]});
+    }
+    // Would collapsing `from` into `to` leave the mesh a manifold, with no
+    // triangles flipped over?
+    bool collapse_ok(uint32_t from, uint32_t to,
+                     std::vector<uint32_t>& from_neighbours,
+                     std::vector<uint32_t>& to_neighbours,
+                     std::vector<uint32_t>& shared) const {
+      // The only vertices next to both ends of the edge should be the
+      // corners opposite it.
+      size_t opposite = 0;
+      bool adjacent = false;
+      for(uint32_t t : vertex_triangles[from]) {
+        if(!alive[t] || !has(t, to)) continue;
+        adjacent = true;
+        ++opposite;
+      }
+      if(!adjacent) return false;
+      neighbours(from, from_neighbours);
+      neighbours(to, to_neighbours);
+      shared.clear();
+      std::set_intersection(from_neighbours.begin(), from_neighbours.end(),
+                            to_neighbours.begin(), to_neighbours.end(),
+                            std::back_inserter(shared));
+      if(shared.size() != opposite) return false;
+      for(uint32_t t : vertex_triangles[from]) {
+        if(!alive[t] || has(t, to)) continue;
+        FVector before = triangle_normal(t, from, from);
+        FVector after = triangle_normal(t, from, to);
+        if((before | after) <= 0.0f || after.IsNearlyZero(1e-12f))
+          return false;
+      }
+      return true;
+    }
+    size_t simplify_band(int band, size_t budget) {
+      collapse_queue queue;
+      for(uint32_t t : band_triangles[band]) {
+        for(int i = 0; i < 3; ++i) {
+          uint32_t a = corners[t*3+i], b = corners[t*3+(i+1)%3];
+          consider(queue, band, a, b);
+          consider(queue, band, b, a);
+        }
+      }
+      std::vector<uint32_t> from_neighbours, to_neighbours, shared;
+      size_t removed = 0;
+      while(!queue.empty() && removed < budget) {
+        collapse c = queue.top();
+        queue.pop();
+        if(!can_move(band, c.from, c.to)) continue;
+        if(c.from_version != version[c.from]
+           || c.to_version != version[c.to]) {
+          // Something changed since this was worked out. Try again later
+          // (if it's still an edge).
+          consider(queue, band, c.from, c.to);
+          continue;
+        }
+        if(max_error_squared > 0 && c.cost > max_error_squared) break;
+        if(!collapse_ok(c.from, c.to, from_neighbours, to_neighbours, shared))
+          continue;
+        for(uint32_t t : vertex_triangles[c.from]) {
+          if(!alive[t]) continue;
+          if(has(t, c.to)) {
+            alive[t] = 0;
+            ++removed;
+            continue;
+          }
+          for(int i = 0; i < 3; ++i) {
+            if(corners[t*3+i] == c.from) corners[t*3+i] = c.to;
+          }
+          vertex_triangles[c.to].push_back(t);
+        }
+        vertex_triangles[c.from].clear();
+        collapsed[c.from] = 1;
+        quadrics[c.to] += quadrics[c.from];
+        ++version[c.to];
+        neighbours(c.to, to_neighbours);
+        for(uint32_t w : to_neighbours) {
+          consider(queue, band, c.to, w);
+          consider(queue, band, w, c.to);
+        }
+      }
+      return removed;
+    }
+    // Split the mesh into `num_bands` bands, starting `offset` vertices in.
+    void assign_bands(int num_bands, size_t offset) {
+      size_t vertex_count = positions.size();
+      size_t band_size = (vertex_count + num_bands - 1) / num_bands;
+      auto band_of = [&](uint32_t v) {
+        return int(((v + offset) / band_size) % num_bands);
+      };
+      band_triangles.assign(num_bands, std::vector<uint32_t>());
+      std::vector<int> triangle_band(alive.size(), -1);
+      for(uint32_t t = 0; t < alive.size(); ++t) {
+        if(!alive[t]) continue;
+        uint32_t lowest = std::min({corners[t*3], corners[t*3+1],
+                                    corners[t*3+2]});
+        triangle_band[t] = band_of(lowest);
+        band_triangles[triangle_band[t]].push_back(t);
+      }
+      ParallelFor(vertex_count, [&](int32 v) {
+        int band = -2;
+        for(uint32_t t : vertex_triangles[v]) {
+          if(!alive[t]) continue;
+          if(band == -2) band = triangle_band[t];
+          else if(band != triangle_band[t]) band = -1;
+        }
+        vertex_band[v] = band < 0 ? -1 : band;
+      });
+    }
+  public:
+    simplifier(const FBakedMesh& mesh, float max_error)
+      : positions(*mesh.vertices), texcoords(*mesh.texcoords),
+        max_error_squared(double(max_error) * max_error),
+        corners(*mesh.indices) {
+      size_t vertex_count = positions.size();
+      size_t triangle_count = corners.size() / 3;
+      corners.resize(triangle_count * 3);
+      alive.assign(triangle_count, 1);
+      alive_count = triangle_count;
+      locked.assign(vertex_count, 0);
+      collapsed.assign(vertex_count, 0);
+      vertex_triangles.resize(vertex_count);
+      quadrics.resize(vertex_count);
+      version.assign(vertex_count, 0);
+      vertex_band.assign(vertex_count, -1);
+      for(uint32_t t = 0; t < triangle_count; ++t) {
+        // Every corner of every triangle gets that triangle's plane,
+        // weighted by its area.
+        FVector n = triangle_normal(t, ~0u, ~0u);
+        double area = n.Size() * 0.5;
+        if(area > 0) {
+          FVector unit = n / (area * 2.0);
+          double d = -(unit | positions[corners[t*3]]);
+          for(int i = 0; i < 3; ++i) {
+            quadrics[corners[t*3+i]].add_plane(unit.X, unit.Y, unit.Z, d,
+                                               area);
+          }
+        }
+        for(int i = 0; i < 3; ++i)
+          vertex_triangles[corners[t*3+i]].push_back(t);
+      }
+      // Work out which vertices have to stay put.
+      ParallelFor(vertex_count, [&](int32 v) {
+        std::vector<uint32_t> around;
+        size_t edges = 0;
+        bool seam = false;
+        for(uint32_t t : vertex_triangles[v]) {
+          for(int i = 0; i < 3; ++i) {
+            uint32_t w = corners[t*3+i];
+            if(w == uint32_t(v)) continue;
+            around.push_back(w);
+            ++edges;
+            // V jumps from 1 to -1 halfway around each ring.
+            if(std::fabs(texcoords[w].Y - texcoords[v].Y) > 1.0f) seam = true;
+          }
+        }
+        std::sort(around.begin(), around.end());
+        size_t unique_count = std::unique(around.begin(), around.end())
+          - around.begin();
+        // On a closed surface every edge is in exactly two triangles, so
+        // each neighbour shows up exactly twice.
+        bool open = edges != unique_count * 2;
+        // An endcap tip is a ring all by itself, joined only to the ring next
+        // to it: every neighbour has the same theta (U), and it isn't the
+        // tip's own. (Its valence is just the size of that ring, which can
+        // be small, so that alone won't do. Neither will looking at vertex
+        // numbers, which needn't be in ring order.)
+        bool tip = unique_count != 0
+          && texcoords[around[0]].X != texcoords[v].X
+          && std::all_of(around.begin(), around.begin() + unique_count,
+                         [&](uint32_t w) {
+                           return texcoords[w].X == texcoords[around[0]].X;
+                         });
+        if(seam || open || tip || unique_count > APEX_VALENCE) locked[v] = 1;
+      });
+    }
+    void run(size_t target_triangles) {
+      int num_bands = std::max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+      size_t vertex_count = positions.size();
+      int idle_passes = 0;
+      for(int pass = 0; idle_passes < MAX_IDLE_PASSES; ++pass) {
+        if(target_triangles != 0 && alive_count <= target_triangles) break;
+        // Once the bands stop helping, one band (everything) mops up.
+        int bands = idle_passes > 0 ? 1 : num_bands;
+        size_t band_size = (vertex_count + bands - 1) / bands;
+        assign_bands(bands, pass % 2 == 0 ? 0 : band_size / 2);
+        std::vector<size_t> removed(bands, 0);
+        ParallelFor(bands, [&](int32 band) {
+          size_t budget = ~size_t(0);
+          if(target_triangles != 0) {
+            // Everybody takes their share of what's left to remove.
+            double share = double(band_triangles[band].size()) / alive_count;
+            budget = size_t(std::ceil((alive_count - target_triangles)
+                                      * share));
+          }
+          removed[band] = simplify_band(band, budget);
+        });
+        size_t total = 0;
+        for(size_t r : removed) total += r;
+        alive_count -= total;
+        if(total == 0) ++idle_passes;
+        else if(bands == 1 && target_triangles == 0) break; // nothing left
+        else idle_passes = 0;
+      }
+    }
+    FBakedMesh result() const {
+      static constexpr uint32_t UNUSED = ~uint32_t(0);
+      std::vector<uint32_t> remap(positions.size(), UNUSED);
+      auto out_vertices = std::make_shared<std::vector<FVector>>();
+      auto out_texcoords = std::make_shared<std::vector<FVector2D>>();
+      auto out_indices = std::make_shared<std::vector<uint32_t>>();
+      out_indices->reserve(alive_count * 3);
+      // Keep the vertices in their original order, so rings stay together.
+      for(uint32_t t = 0; t < alive.size(); ++t) {
+        if(!alive[t]) continue;
+        for(int i = 0; i < 3; ++i) remap[corners[t*3+i]] = 0;
+      }
+      for(uint32_t v = 0; v < positions.size(); ++v) {
+        if(remap[v] == UNUSED) continue;
+        remap[v] = out_vertices->size();
+        out_vertices->push_back(positions[v]);
+        out_texcoords->push_back(texcoords[v]);
+      }
+      for(uint32_t t = 0; t < alive.size(); ++t) {
+        if(!alive[t]) continue;
+        for(int i = 0; i < 3; ++i)
+          out_indices->push_back(remap[corners[t*3+i]]);
+      }
+      return FBakedMesh(out_vertices, out_texcoords, out_indices);
+    }
+  };
+}
+
+FBakedMesh simplify_mesh(const FBakedMesh& mesh, size_t target_triangles,
+                         float max_error) {
+  if(mesh.vertices == nullptr || mesh.indices->empty()) return mesh;
+  if(target_triangles == 0 && !(max_error > 0)) return mesh;
+  simplifier s(mesh, max_error);
+  s.run(target_triangles);
+  return s.result();
+}
@@ -0,0 +1,45 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BakedMesh.h"
+
+/**
+ * Quadric error simplification (Garland and Heckbert), by collapsing edges
+ * into one of their ends, so every vertex that's left keeps its original
+ * position and texture coordinates.
+ *
+ * Stops once there are no more than `target_triangles` triangles (if that
+ * isn't 0), or once the next collapse would move the surface by more than
+ * `max_error` on average (if that's more than 0), whichever comes first.
+ *
+ * Some vertices are never removed: ones along the jump in V halfway around
+ * each ring (see build_shell_at), endcap tips, and ones on open edges of the
+ * mesh. That keeps the texture seam, the pointy bits, and the outline where
+ * they were.
+ *
+ * The mesh is split into bands of consecutive vertex numbers (for a shell,
+ * bands of consecutive rings), which get simplified at the same time. The
+ * bands move between passes, so their edges get their turn too.
+ */
+FBakedMesh simplify_mesh(const FBakedMesh& mesh, size_t target_triangles,
+                         float max_error);
@@ -0,0 +1,37 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <memory>
+#include <string>
+
+// Pieces of OBJ files, for anybody writing one. (ObjWriter.cpp has the
+// details.)
+
+/** Adds the extension to `filename` if needed and puts the result in path. */
+std::unique_ptr<IFileHandle> open_obj_file(const FString& filename,
+                                           FString& path);
+std::string obj_comment_header(const TArray<FString>& comments);
+void append_obj_vertex(std::string& out, const FVector& v);
+void append_obj_texcoord(std::string& out, const FVector2D& uv);
+/** The indices are one-based, like OBJ wants. */
+void append_obj_face(std::string& out, uint64 a, uint64 b, uint64 c);
@@ -0,0 +1,67 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "CoreMinimal.h"
+#include "ornament_spec.h"
+
+namespace {
+  constexpr float TAU = 6.28318530717958647692f;
+  // 0 at the troughs, 1 at the crests, sharpened by `sharpness`
+  inline float wave(float phase, float sharpness) {
+    float w = 0.5f + 0.5f * cosf(TAU * phase);
+    if(sharpness == 1.0f) return w;
+    return powf(w, sharpness);
+  }
+  // How far the phase of each feature advances per unit of theta. (Theta is
+  // in 180° units, so there are two per whorl.)
+  inline float per_theta(float per_whorl) { return per_whorl * 0.5f; }
+}
+
+float ornament_spec::sample(float theta, float v) const {
+  float rib = wave(theta * per_theta(ribs_per_whorl), rib_sharpness);
+  float node = rib * wave(v * nodes_across_section, node_sharpness);
+  float spiral = wave(v * spiral_cords
+                      + theta * per_theta(spiral_twist_per_whorl),
+                      spiral_sharpness);
+  return rib * rib_height + node * node_height + spiral * spiral_height;
+}
+
+void ornament_spec::sample_many(const float* thetas, const float* vs,
+                                float* out, size_t count) const {
+  const float rib_rate = per_theta(ribs_per_whorl);
+  const float twist_rate = per_theta(spiral_twist_per_whorl);
+  // One feature at a time, so each loop is a straight line of arithmetic.
+  // Skip the features that are switched off entirely.
+  for(size_t n = 0; n < count; ++n) out[n] = 0.0f;
+  if(rib_height != 0.0f || node_height != 0.0f) {
+    for(size_t n = 0; n < count; ++n) {
+      float rib = wave(thetas[n] * rib_rate, rib_sharpness);
+      float node = node_height != 0.0f
+        ? rib * wave(vs[n] * nodes_across_section, node_sharpness) : 0.0f;
+      out[n] += rib * rib_height + node * node_height;
+    }
+  }
+  if(spiral_height != 0.0f) {
+    for(size_t n = 0; n < count; ++n) {
+      out[n] += wave(vs[n] * spiral_cords + thetas[n] * twist_rate,
+                     spiral_sharpness) * spiral_height;
+    }
+  }
+}
@@ -0,0 +1,204 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "self_intersection.h"
+#include "shell_bvh.h"
+
+#include "Async/ParallelFor.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+std::vector<uint32_t> ring_numbers(const FBakedMesh& mesh) {
+  const auto& texcoords = *mesh.texcoords;
+  std::vector<uint32_t> ret(texcoords.size());
+  uint32_t ring = 0;
+  for(size_t v = 0; v < texcoords.size(); ++v) {
+    // Every ring starts at V = 0 (see build_shell_at). An endcap tip is
+    // just one vertex, at V = 1, with a theta of its own.
+    if(v > 0 && (texcoords[v].Y == 0.0f
+                 || texcoords[v].X != texcoords[v - 1].X)) {
+      ++ring;
+    }
+    ret[v] = ring;
+  }
+  return ret;
+}
+
+namespace {
+  // Six times the signed volume of the tetrahedron abcd: positive if d is on
+  // the side of triangle abc that its normal points to (counterclockwise
+  // winding), negative if it's on the other side.
+  double orient3d(const FVector& a, const FVector& b, const FVector& c,
+                  const FVector& d) {
+    double ax = double(a.X) - d.X, ay = double(a.Y) - d.Y,
+      az = double(a.Z) - d.Z;
+    double bx = double(b.X) - d.X, by = double(b.Y) - d.Y,
+      bz = double(b.Z) - d.Z;
+    double cx = double(c.X) - d.X, cy = double(c.Y) - d.Y,
+      cz = double(c.Z) - d.Z;
+    return -(ax * (by * cz - bz * cy) - ay * (bx * cz - bz * cx)
+             + az * (bx * cy - by * cx));
+  }
+  // Whether segment pq goes right through triangle abc (not just touching
+  // it).
+  bool segment_crosses_triangle(const FVector& p, const FVector& q,
+                                const FVector& a, const FVector& b,
+                                const FVector& c) {
+    double sp = orient3d(a, b, c, p), sq = orient3d(a, b, c, q);
+    if(!((sp < 0 && sq > 0) || (sp > 0 && sq < 0))) return false;
+    double e0 = orient3d(p, q, a, b), e1 = orient3d(p, q, b, c),
+      e2 = orient3d(p, q, c, a);
+    return (e0 > 0 && e1 > 0 && e2 > 0) || (e0 < 0 && e1 < 0 && e2 < 0);
+  }
+  bool triangles_cross(const shell_bvh& bvh, uint32_t s, uint32_t t) {
+    for(int pass = 0; pass < 2; ++pass) {
+      const FVector& a = bvh.corner(t, 0);
+      const FVector& b = bvh.corner(t, 1);
+      const FVector& c = bvh.corner(t, 2);
+      for(int i = 0; i < 3; ++i) {
+        if(segment_crosses_triangle(bvh.corner(s, i),
+                                    bvh.corner(s, (i + 1) % 3), a, b, c)) {
+          return true;
+        }
+      }
+      std::swap(s, t);
+    }
+    return false;
+  }
+  bool share_corner(const shell_bvh& bvh, uint32_t s, uint32_t t) {
+    for(int i = 0; i < 3; ++i) {
+      for(int j = 0; j < 3; ++j) {
+        if(bvh.index(s, i) == bvh.index(t, j)) return true;
+      }
+    }
+    return false;
+  }
+  typedef std::pair<uint32_t, uint32_t> band_pair;
+}
+
+std::vector<self_intersection> find_self_intersections(const shell_bvh& bvh) {
+  std::vector<self_intersection> ret;
+  uint32_t leaf_count = bvh.leaf_count();
+  if(leaf_count == 0) return ret;
+  // Band n is the triangles between ring n and ring n + 1, so each triangle
+  // is in the band of its youngest ring.
+  auto rings = ring_numbers(bvh.mesh);
+  std::vector<uint32_t> band(bvh.triangle_count);
+  std::vector<uint32_t> leaf_first_band(leaf_count), leaf_last_band(leaf_count);
+  ParallelFor(leaf_count, [&](int32 leaf) {
+    uint32_t first = ~uint32_t(0), last = 0;
+    for(uint32_t t = bvh.leaf_begin(leaf); t < bvh.leaf_end(leaf); ++t) {
+      band[t] = std::min({rings[bvh.index(t, 0)], rings[bvh.index(t, 1)],
+                          rings[bvh.index(t, 2)]});
+      first = std::min(first, band[t]);
+      last = std::max(last, band[t]);
+    }
+    leaf_first_band[leaf] = first;
+    leaf_last_band[leaf] = last;
+  });
+  // Each leaf checks itself against every leaf after it that its box
+  // touches, all at once.
+  std::vector<std::vector<band_pair>> found(leaf_count);
+  ParallelFor(leaf_count, [&](int32 leaf) {
+    const FBox& box = bvh.leaf_bounds[leaf];
+    auto& out = found[leaf];
+    bvh.for_each_leaf([&](const FBox& other) { return box.Intersect(other); },
+                      [&](uint32_t other) {
+      if(other <= uint32_t(leaf)) return;
+      // Don't bother if every band in one is next to every band in the
+      // other. That's the common case: next door along the ring, or in the
+      // neighbouring band.
+      if(leaf_last_band[other] <= leaf_first_band[leaf] + 1
+         && leaf_last_band[leaf] <= leaf_first_band[other] + 1) return;
+      for(uint32_t s = bvh.leaf_begin(leaf); s < bvh.leaf_end(leaf); ++s) {
+        for(uint32_t t = bvh.leaf_begin(other); t < bvh.leaf_end(other);
+            ++t) {
+          uint32_t young = std::min(band[s], band[t]);
+          uint32_t old = std::max(band[s], band[t]);
+          if(old <= young + 1 || share_corner(bvh, s, t)) continue;
+          if(triangles_cross(bvh, s, t)) out.emplace_back(young, old);
+        }
+      }
+    });
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+  });
+  std::vector<band_pair> pairs;
+  for(const auto& leaf_pairs : found) {
+    pairs.insert(pairs.end(), leaf_pairs.begin(), leaf_pairs.end());
+  }
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+  // Pairs of bands that are next to each other (both ways) are the same
+  // place. Lump them together.
+  auto key = [](uint32_t young, uint32_t old) {
+    return (uint64(young) << 32) | old;
+  };
+  std::unordered_map<uint64, uint32_t> pair_index;
+  for(uint32_t n = 0; n < pairs.size(); ++n) {
+    pair_index[key(pairs[n].first, pairs[n].second)] = n;
+  }
+  std::vector<uint32_t> parent(pairs.size());
+  for(uint32_t n = 0; n < pairs.size(); ++n) parent[n] = n;
+  auto root = [&](uint32_t n) {
+    while(parent[n] != n) n = parent[n] = parent[parent[n]];
+    return n;
+  };
+  for(uint32_t n = 0; n < pairs.size(); ++n) {
+    uint32_t young = pairs[n].first, old = pairs[n].second;
+    // (Only the ones before this one in the sorted list; the ones after
+    // will look back at this one.)
+    for(int dyoung = -1; dyoung <= 0; ++dyoung) {
+      for(int dold = -1; dold <= 1; ++dold) {
+        if(dyoung == 0 && dold >= 0) continue;
+        if(young == 0 && dyoung < 0) continue;
+        auto found_pair = pair_index.find(key(young + dyoung, old + dold));
+        if(found_pair == pair_index.end()) continue;
+        parent[root(found_pair->second)] = root(n);
+      }
+    }
+  }
+  std::unordered_map<uint32_t, uint32_t> group_of_root;
+  for(uint32_t n = 0; n < pairs.size(); ++n) {
+    uint32_t r = root(n);
+    auto group = group_of_root.find(r);
+    // Bands become rings: band n reaches from ring n to ring n + 1.
+    uint32_t young = pairs[n].first, old = pairs[n].second;
+    if(group == group_of_root.end()) {
+      group_of_root[r] = ret.size();
+      ret.push_back(self_intersection{young, young + 1, old, old + 1});
+    }
+    else {
+      auto& where = ret[group->second];
+      where.young_first = std::min(where.young_first, young);
+      where.young_last = std::max(where.young_last, young + 1);
+      where.old_first = std::min(where.old_first, old);
+      where.old_last = std::max(where.old_last, old + 1);
+    }
+  }
+  std::sort(ret.begin(), ret.end(),
+            [](const self_intersection& a, const self_intersection& b) {
+              return a.young_first < b.young_first
+                || (a.young_first == b.young_first
+                    && a.old_first < b.old_first);
+            });
+  return ret;
+}
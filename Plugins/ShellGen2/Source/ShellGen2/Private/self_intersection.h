@@ -0,0 +1,51 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <vector>
+#include "BakedMesh.h"
+
+struct shell_bvh;
+
+/**
+ * Which ring each vertex of the mesh is on, counting from the young end, for
+ * a mesh laid out the way the generator makes them (one ring after another,
+ * each starting at V = 0). A mesh that's had its vertices reordered gets
+ * numbers that don't mean much.
+ */
+std::vector<uint32_t> ring_numbers(const FBakedMesh& mesh);
+
+/**
+ * Somewhere the shell runs into itself: the rings from young_first to
+ * young_last pass through the rings from old_first to old_last.
+ */
+struct self_intersection {
+  uint32_t young_first, young_last, old_first, old_last;
+};
+
+/**
+ * Every place the mesh passes through itself, youngest first. Triangles in
+ * the same or neighbouring ring bands (and triangles sharing a corner) are
+ * never tested against each other, since they're supposed to touch. Just
+ * touching doesn't count, only actually passing through.
+ */
+std::vector<self_intersection> find_self_intersections(const shell_bvh& bvh);
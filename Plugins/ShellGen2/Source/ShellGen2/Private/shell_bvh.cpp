@@ -0,0 +1,270 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "shell_bvh.h"
+
+#include "Async/ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Below this many leaves, building both halves of a subtree at once costs
+// more than it saves.
+static constexpr uint32_t PARALLEL_BUILD_LEAVES = 1024;
+
+shell_bvh::shell_bvh(const FBakedMesh& mesh) : mesh(mesh) {
+  if(mesh.indices == nullptr || mesh.vertices == nullptr) return;
+  triangle_count = mesh.indices->size() / 3;
+  uint32_t count = (triangle_count + LEAF_TRIANGLES - 1) / LEAF_TRIANGLES;
+  if(count == 0) return;
+  leaf_bounds.resize(count);
+  std::vector<FVector> centers(count);
+  ParallelFor(count, [&](int32 leaf) {
+    FBox box(ForceInit);
+    for(uint32_t t = leaf_begin(leaf); t < leaf_end(leaf); ++t) {
+      for(int i = 0; i < 3; ++i) box += corner(t, i);
+    }
+    leaf_bounds[leaf] = box;
+    centers[leaf] = box.GetCenter();
+  });
+  std::vector<uint32_t> leaves(count);
+  std::iota(leaves.begin(), leaves.end(), 0);
+  // A binary tree with n leaves has 2n - 1 nodes, so every subtree knows
+  // exactly where its nodes go, and both halves can be built at once.
+  nodes.resize(count * 2 - 1);
+  build(0, leaves.data(), count, centers);
+}
+
+void shell_bvh::build(uint32_t node_index, uint32_t* leaves, uint32_t count,
+                      const std::vector<FVector>& centers) {
+  node& here = nodes[node_index];
+  if(count == 1) {
+    here.bounds = leaf_bounds[*leaves];
+    here.second_child = 0;
+    here.leaf = *leaves;
+    return;
+  }
+  // Split across the longest side of the box around the leaves' centers,
+  // half on each side.
+  FBox center_box(ForceInit);
+  for(uint32_t n = 0; n < count; ++n) center_box += centers[leaves[n]];
+  FVector size = center_box.GetSize();
+  int axis = size.X >= size.Y && size.X >= size.Z ? 0 : size.Y >= size.Z ? 1
+    : 2;
+  uint32_t half = count / 2;
+  std::nth_element(leaves, leaves + half, leaves + count,
+                   [&](uint32_t a, uint32_t b) {
+                     return centers[a][axis] < centers[b][axis];
+                   });
+  uint32_t first = node_index + 1;
+  uint32_t second = node_index + half * 2;
+  if(count >= PARALLEL_BUILD_LEAVES) {
+    ParallelFor(2, [&](int32 which) {
+      if(which == 0) build(first, leaves, half, centers);
+      else build(second, leaves + half, count - half, centers);
+    });
+  }
+  else {
+    build(first, leaves, half, centers);
+    build(second, leaves + half, count - half, centers);
+  }
+  here.bounds = nodes[first].bounds + nodes[second].bounds;
+  here.second_child = second;
+  here.leaf = 0;
+}
+
+namespace {
+  // Where the ray enters the box (0 if it starts inside), or a negative
+  // number if it misses it (or gets there after `max_distance`).
+  float ray_enters_box(const FBox& box, const FVector& origin,
+                       const FVector& inverse_direction, float max_distance) {
+    float near = 0.0f, far = max_distance;
+    for(int axis = 0; axis < 3; ++axis) {
+      float t0 = (box.Min[axis] - origin[axis]) * inverse_direction[axis];
+      float t1 = (box.Max[axis] - origin[axis]) * inverse_direction[axis];
+      // (NaN, from a ray lying in one of the box's faces, falls through to
+      // the other side of these comparisons and leaves near/far alone.)
+      if(t0 > t1) std::swap(t0, t1);
+      if(t0 > near) near = t0;
+      if(t1 < far) far = t1;
+      if(near > far) return -1.0f;
+    }
+    return near;
+  }
+  float box_distance_squared(const FBox& box, const FVector& point) {
+    float ret = 0.0f;
+    for(int axis = 0; axis < 3; ++axis) {
+      float d = FMath::Max(FMath::Max(box.Min[axis] - point[axis],
+                                      point[axis] - box.Max[axis]), 0.0f);
+      ret += d * d;
+    }
+    return ret;
+  }
+  // Moller-Trumbore.
+  bool ray_hits_triangle(const FVector& origin, const FVector& direction,
+                         const FVector& a, const FVector& b,
+                         const FVector& c, float& t, float& b1, float& b2) {
+    FVector e1 = b - a, e2 = c - a;
+    FVector p = direction ^ e2;
+    float determinant = e1 | p;
+    if(std::fabs(determinant) < 1e-12f) return false;
+    float inverse = 1.0f / determinant;
+    FVector s = origin - a;
+    b1 = (s | p) * inverse;
+    if(b1 < 0.0f || b1 > 1.0f) return false;
+    FVector q = s ^ e1;
+    b2 = (direction | q) * inverse;
+    if(b2 < 0.0f || b1 + b2 > 1.0f) return false;
+    t = (e2 | q) * inverse;
+    return t >= 0.0f;
+  }
+  // The closest point to p on triangle abc, as weights of b and c. (From
+  // Ericson's "Real-Time Collision Detection", 5.1.5.)
+  void closest_on_triangle(const FVector& p, const FVector& a,
+                           const FVector& b, const FVector& c,
+                           float& b1, float& b2) {
+    FVector ab = b - a, ac = c - a, ap = p - a;
+    float d1 = ab | ap, d2 = ac | ap;
+    if(d1 <= 0.0f && d2 <= 0.0f) { b1 = 0; b2 = 0; return; }
+    FVector bp = p - b;
+    float d3 = ab | bp, d4 = ac | bp;
+    if(d3 >= 0.0f && d4 <= d3) { b1 = 1; b2 = 0; return; }
+    float vc = d1 * d4 - d3 * d2;
+    if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+      b1 = d1 / (d1 - d3);
+      b2 = 0;
+      return;
+    }
+    FVector cp = p - c;
+    float d5 = ab | cp, d6 = ac | cp;
+    if(d6 >= 0.0f && d5 <= d6) { b1 = 0; b2 = 1; return; }
+    float vb = d5 * d2 - d1 * d6;
+    if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+      b1 = 0;
+      b2 = d2 / (d2 - d6);
+      return;
+    }
+    float va = d3 * d6 - d5 * d4;
+    if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+      b2 = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+      b1 = 1.0f - b2;
+      return;
+    }
+    float denominator = 1.0f / (va + vb + vc);
+    b1 = vb * denominator;
+    b2 = vc * denominator;
+  }
+}
+
+bool shell_bvh::ray_cast(const FVector& origin, const FVector& direction,
+                         float max_distance, hit& out) const {
+  if(nodes.empty()) return false;
+  FVector inverse(1.0f / direction.X, 1.0f / direction.Y, 1.0f / direction.Z);
+  float best = max_distance;
+  bool found = false;
+  // Nearer child first, so `best` shrinks as fast as possible.
+  std::pair<uint32_t, float> stack[64];
+  int depth = 0;
+  float root_near = ray_enters_box(nodes[0].bounds, origin, inverse, best);
+  if(root_near < 0.0f) return false;
+  stack[depth++] = std::make_pair(0u, root_near);
+  while(depth > 0) {
+    auto top = stack[--depth];
+    if(top.second > best) continue;
+    const node& here = nodes[top.first];
+    if(here.second_child == 0) {
+      for(uint32_t t = leaf_begin(here.leaf); t < leaf_end(here.leaf); ++t) {
+        float distance, b1, b2;
+        if(!ray_hits_triangle(origin, direction, corner(t, 0), corner(t, 1),
+                              corner(t, 2), distance, b1, b2)) continue;
+        if(distance > best) continue;
+        best = distance;
+        found = true;
+        out.triangle = t;
+        out.distance = distance;
+        out.b1 = b1;
+        out.b2 = b2;
+      }
+      continue;
+    }
+    uint32_t first = top.first + 1, second = here.second_child;
+    float first_near = ray_enters_box(nodes[first].bounds, origin, inverse,
+                                      best);
+    float second_near = ray_enters_box(nodes[second].bounds, origin, inverse,
+                                       best);
+    if(first_near >= 0.0f && second_near >= 0.0f
+       && second_near < first_near) {
+      std::swap(first, second);
+      std::swap(first_near, second_near);
+    }
+    if(second_near >= 0.0f) stack[depth++] = std::make_pair(second,
+                                                            second_near);
+    if(first_near >= 0.0f) stack[depth++] = std::make_pair(first, first_near);
+  }
+  if(found) out.position = origin + direction * out.distance;
+  return found;
+}
+
+bool shell_bvh::closest_point(const FVector& point, float max_distance,
+                              hit& out) const {
+  if(nodes.empty()) return false;
+  float best = max_distance * max_distance;
+  bool found = false;
+  std::pair<uint32_t, float> stack[64];
+  int depth = 0;
+  stack[depth++] = std::make_pair(0u, box_distance_squared(nodes[0].bounds,
+                                                           point));
+  while(depth > 0) {
+    auto top = stack[--depth];
+    if(top.second > best) continue;
+    const node& here = nodes[top.first];
+    if(here.second_child == 0) {
+      for(uint32_t t = leaf_begin(here.leaf); t < leaf_end(here.leaf); ++t) {
+        const FVector& a = corner(t, 0);
+        const FVector& b = corner(t, 1);
+        const FVector& c = corner(t, 2);
+        float b1, b2;
+        closest_on_triangle(point, a, b, c, b1, b2);
+        FVector on = a + (b - a) * b1 + (c - a) * b2;
+        float distance = (on - point).SizeSquared();
+        if(distance > best) continue;
+        best = distance;
+        found = true;
+        out.triangle = t;
+        out.position = on;
+        out.b1 = b1;
+        out.b2 = b2;
+      }
+      continue;
+    }
+    uint32_t first = top.first + 1, second = here.second_child;
+    float first_near = box_distance_squared(nodes[first].bounds, point);
+    float second_near = box_distance_squared(nodes[second].bounds, point);
+    if(second_near < first_near) {
+      std::swap(first, second);
+      std::swap(first_near, second_near);
+    }
+    stack[depth++] = std::make_pair(second, second_near);
+    stack[depth++] = std::make_pair(first, first_near);
+  }
+  if(found) out.distance = std::sqrt(best);
+  return found;
+}
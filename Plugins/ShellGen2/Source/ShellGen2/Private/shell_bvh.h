@@ -0,0 +1,117 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <vector>
+#include "BakedMesh.h"
+
+/**
+ * A bounding volume hierarchy over an FBakedMesh's triangles.
+ *
+ * The leaves are runs of up to LEAF_TRIANGLES consecutive triangles. For a
+ * mesh straight out of the generator, stitch_rings lays each band between
+ * two rings out in order around the ring, so a leaf is a short segment of
+ * one ring band: small, nearly flat, and tightly boxed. Any other mesh works
+ * too, the boxes just aren't as tight.
+ *
+ * It keeps its own references to the mesh's buffers, so it stays good for
+ * as long as it's around. Nothing in it changes after it's built, so any
+ * number of threads can use it at once.
+ */
+struct shell_bvh {
+  static constexpr uint32_t LEAF_TRIANGLES = 8;
+  struct node {
+    FBox bounds;
+    // The first child is always the very next node. This is the other one,
+    // or 0 if this is a leaf.
+    uint32_t second_child;
+    // Which leaf this is, if it is one.
+    uint32_t leaf;
+  };
+  FBakedMesh mesh;
+  size_t triangle_count = 0;
+  // The root is nodes[0]. Empty if the mesh has no triangles.
+  std::vector<node> nodes;
+  std::vector<FBox> leaf_bounds;
+  explicit shell_bvh(const FBakedMesh& mesh);
+  uint32_t leaf_count() const { return leaf_bounds.size(); }
+  uint32_t leaf_begin(uint32_t leaf) const { return leaf * LEAF_TRIANGLES; }
+  uint32_t leaf_end(uint32_t leaf) const {
+    return FMath::Min<size_t>((leaf + 1) * size_t(LEAF_TRIANGLES),
+                              triangle_count);
+  }
+  uint32_t index(uint32_t triangle, int corner) const {
+    return (*mesh.indices)[triangle * 3 + corner];
+  }
+  const FVector& corner(uint32_t triangle, int corner) const {
+    return (*mesh.vertices)[index(triangle, corner)];
+  }
+  // Where a query landed on the mesh.
+  struct hit {
+    uint32_t triangle;
+    // How far along the ray, or how far from the point.
+    float distance;
+    FVector position;
+    // Weights of the triangle's second and third corners. (The first gets
+    // whatever's left.)
+    float b1, b2;
+  };
+  /**
+   * The first triangle (from either side) the ray from `origin` along
+   * `direction` (which must be normalized) hits within `max_distance`.
+   */
+  bool ray_cast(const FVector& origin, const FVector& direction,
+                float max_distance, hit& out) const;
+  /**
+   * The nearest point on the mesh to `point`, if there is one within
+   * `max_distance`.
+   */
+  bool closest_point(const FVector& point, float max_distance,
+                     hit& out) const;
+  /**
+   * Calls `visit(leaf)` for every leaf whose box, and the boxes of every
+   * node above it, `wanted(box)` says yes to.
+   */
+  template<typename Wanted, typename Visit>
+  void for_each_leaf(const Wanted& wanted, const Visit& visit) const {
+    if(nodes.empty()) return;
+    // Splitting at the median keeps the tree well under 64 deep.
+    uint32_t stack[64];
+    int depth = 0;
+    stack[depth++] = 0;
+    while(depth > 0) {
+      uint32_t n = stack[--depth];
+      const node& here = nodes[n];
+      if(!wanted(here.bounds)) continue;
+      if(here.second_child == 0) {
+        visit(here.leaf);
+      }
+      else {
+        stack[depth++] = here.second_child;
+        stack[depth++] = n + 1;
+      }
+    }
+  }
+private:
+  void build(uint32_t node_index, uint32_t* leaves, uint32_t count,
+             const std::vector<FVector>& centers);
+};
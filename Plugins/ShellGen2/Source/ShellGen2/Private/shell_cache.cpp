@@ -0,0 +1,240 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "shell_cache.h"
+#include "Hash/CityHash.h"
+
+namespace {
+  template<class T> void put(std::vector<uint8>& out, const T& value) {
+    const uint8* p = reinterpret_cast<const uint8*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+  }
+  void put(std::vector<uint8>& out, const FVector2D& value) {
+    put(out, value.X);
+    put(out, value.Y);
+  }
+  void put(std::vector<uint8>& out, const Curve& curve) {
+    put(out, static_cast<int32>(curve.get_type()));
+    put(out, static_cast<int32>(curve.curve.Num()));
+    for(const auto& node : curve.curve) {
+      put(out, node.anchor);
+      put(out, node.control);
+      put(out, node.virtual_proportion);
+    }
+  }
+  template<class T>
+  void put(std::vector<uint8>& out, const TArray<T>& array) {
+    put(out, static_cast<int32>(array.Num()));
+    for(const auto& value : array) put(out, value);
+  }
+  // Only the plain values; which image or ornament gets sampled is left to
+  // same_distortion, since equal ornaments needn't live at the same address.
+  void put(std::vector<uint8>& out, const distortion_snapshot& distortion) {
+    const auto& source = distortion.source;
+    put(out, static_cast<uint8>(source.image != nullptr));
+    put(out, static_cast<uint8>(source.ornament != nullptr));
+    if(source.ornament) put(out, *source.ornament);
+    put(out, source.uv_scale);
+    put(out, source.uv_offset);
+    put(out, static_cast<uint8>(source.wrap_at_v));
+    put(out, static_cast<uint8>(source.filter_by_footprint));
+    put(out, distortion.magnitude);
+    put(out, distortion.magnitude_offset);
+    put(out, static_cast<int32>(distortion.composed.size()));
+    for(const auto& op : distortion.composed) {
+      put(out, static_cast<int32>(op.first));
+      put(out, op.second);
+    }
+  }
+  bool same_distortion(const distortion_snapshot& a,
+                       const distortion_snapshot& b) {
+    if(!(a.source == b.source) || a.magnitude != b.magnitude
+       || a.magnitude_offset != b.magnitude_offset
+       || a.composed.size() != b.composed.size())
+      return false;
+    for(size_t n = 0; n < a.composed.size(); ++n) {
+      if(a.composed[n].first != b.composed[n].first
+         || !same_distortion(a.composed[n].second, b.composed[n].second))
+        return false;
+    }
+    return true;
+  }
+  uint64 bytes_of(const shell_cache_key& key, const FBakedMesh& mesh,
+                  const TArray<FRadiusInfo>& radius_info) {
+    uint64 ret = key.params.size()
+      + key.distortions.size() * sizeof(distortion_snapshot);
+    if(mesh.vertices) ret += mesh.vertices->size() * sizeof(FVector);
+    if(mesh.texcoords) ret += mesh.texcoords->size() * sizeof(FVector2D);
+    if(mesh.indices) ret += mesh.indices->size() * sizeof(uint32_t);
+    ret += radius_info.Num() * sizeof(FRadiusInfo);
+    const std::vector<FVector>* counted = nullptr;
+    for(const auto& info : radius_info) {
+      ret += info.cross_section.Num() * sizeof(FVector);
+      // They all normally share the same buffer; count it once.
+      if(info.cross_sections && info.cross_sections.get() != counted) {
+        counted = info.cross_sections.get();
+        ret += counted->size() * sizeof(FVector);
+      }
+    }
+    return ret;
+  }
+}
+
+bool shell_cache_key::operator==(const shell_cache_key& other) const {
+  if(hash != other.hash || params != other.params
+     || distortions.size() != other.distortions.size())
+    return false;
+  for(size_t n = 0; n < distortions.size(); ++n) {
+    if(!same_distortion(distortions[n], other.distortions[n])) return false;
+  }
+  return true;
+}
+
+shell_cache_key make_shell_cache_key
+(const shell_params& p, const std::vector<distortion_snapshot>& distortions) {
+  shell_cache_key ret;
+  auto& out = ret.params;
+  // Every field of shell_params, in order. Add new ones here too!
+  put(out, p.starting_normal_rad);
+  put(out, p.starting_binormal_rad);
+  put(out, p.starting_spiral_rad);
+  put(out, p.normal_growth_young);
+  put(out, p.binormal_growth_young);
+  put(out, p.spiral_growth_young);
+  put(out, p.lin_young_end);
+  put(out, p.lin_old_start);
+  put(out, p.young_end);
+  put(out, p.old_start);
+  put(out, p.normal_growth_old);
+  put(out, p.binormal_growth_old);
+  put(out, p.spiral_growth_old);
+  put(out, p.lin_old_end);
+  put(out, p.lin_aperture_start);
+  put(out, p.old_end);
+  put(out, p.aperture_start);
+  put(out, p.normal_growth_aperture);
+  put(out, p.binormal_growth_aperture);
+  put(out, p.spiral_growth_aperture);
+  put(out, p.current_age);
+  put(out, p.final_age);
+  put(out, p.length_per_iteration);
+  put(out, p.theta_exponent);
+  put(out, static_cast<int32>(p.curve_subdivision));
+  put(out, p.young_cross);
+  put(out, p.young_grain);
+  put(out, p.old_cross);
+  put(out, p.old_grain);
+  put(out, p.aperture_cross);
+  put(out, p.aperture_grain);
+  put(out, p.young_endcaps);
+  put(out, p.old_endcaps);
+  put(out, p.radius_requests);
+  put(out, p.spiral_offset_constant);
+  put(out, static_cast<int32>(distortions.size()));
+  for(const auto& distortion : distortions) put(out, distortion);
+  ret.hash = CityHash64(reinterpret_cast<const char*>(out.data()),
+                        static_cast<uint32>(out.size()));
+  ret.distortions = distortions;
+  return ret;
+}
+
+shell_cache& shell_cache::get() {
+  static shell_cache cache;
+  return cache;
+}
+
+shell_cache::entry_it shell_cache::lookup(const shell_cache_key& key) {
+  auto range = by_hash.equal_range(key.hash);
+  for(auto it = range.first; it != range.second; ++it) {
+    if(it->second->key == key) return it->second;
+  }
+  return entries.end();
+}
+
+bool shell_cache::find(const shell_cache_key& key, FBakedMesh& mesh,
+                       TArray<FRadiusInfo>& radius_info) {
+  std::unique_lock<std::mutex> lock(mutex);
+  auto it = lookup(key);
+  if(it == entries.end()) {
+    ++misses;
+    return false;
+  }
+  ++hits;
+  entries.splice(entries.begin(), entries, it);
+  mesh = it->mesh;
+  radius_info = it->radius_info;
+  return true;
+}
+
+void shell_cache::insert(const shell_cache_key& key, const FBakedMesh& mesh,
+                         const TArray<FRadiusInfo>& radius_info) {
+  uint64 bytes = bytes_of(key, mesh, radius_info);
+  std::unique_lock<std::mutex> lock(mutex);
+  auto it = lookup(key);
+  if(it != entries.end()) {
+    // Already held (two generators made the same shell at once). Keep the
+    // one we have, but count it as used.
+    entries.splice(entries.begin(), entries, it);
+    return;
+  }
+  if(bytes > budget) return; // would only push everything else out
+  entries.push_front(entry{key, mesh, radius_info, bytes});
+  by_hash.emplace(key.hash, entries.begin());
+  bytes_held += bytes;
+  evict_down_to(budget);
+}
+
+void shell_cache::evict_down_to(uint64 bytes) {
+  while(bytes_held > bytes && !entries.empty()) {
+    auto victim = std::prev(entries.end());
+    auto range = by_hash.equal_range(victim->key.hash);
+    for(auto it = range.first; it != range.second; ++it) {
+      if(it->second == victim) {
+        by_hash.erase(it);
+        break;
+      }
+    }
+    bytes_held -= victim->bytes;
+    entries.erase(victim);
+  }
+}
+
+void shell_cache::set_budget(uint64 bytes) {
+  std::unique_lock<std::mutex> lock(mutex);
+  budget = bytes;
+  evict_down_to(budget);
+}
+
+void shell_cache::clear() {
+  std::unique_lock<std::mutex> lock(mutex);
+  evict_down_to(0);
+  hits = misses = 0;
+}
+
+shell_cache_stats shell_cache::stats() {
+  std::unique_lock<std::mutex> lock(mutex);
+  shell_cache_stats ret;
+  ret.hits = hits;
+  ret.misses = misses;
+  ret.bytes_held = bytes_held;
+  ret.budget = budget;
+  ret.entries = entries.size();
+  return ret;
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "CoreMinimal.h"
+#include "BakedMesh.h"
+#include "Distortion.h"
+#include "RadiusInfo.h"
+#include "ShellGenerator.h"
+
+/**
+ * Everything that decides what a generated shell looks like: every field of
+ * the shell_params as bytes, plus the Distortions applied while building.
+ * `hash` is stable from run to run; the bytes and Distortions are kept too,
+ * so two different shells can never be mistaken for each other just because
+ * their hashes happen to match.
+ *
+ * Image Distortions compare by which image they use, not by its pixels. The
+ * key keeps the image alive, so its address can't be reused for a different
+ * image while the key is around.
+ */
+struct shell_cache_key {
+  uint64 hash = 0;
+  std::vector<uint8> params;
+  std::vector<distortion_snapshot> distortions;
+  bool operator==(const shell_cache_key& other) const;
+};
+
+shell_cache_key make_shell_cache_key
+(const shell_params& params,
+ const std::vector<distortion_snapshot>& distortions);
+
+struct shell_cache_stats {
+  uint64 hits = 0, misses = 0;
+  uint64 bytes_held = 0, budget = 0;
+  size_t entries = 0;
+};
+
+/**
+ * Finished shells (mesh and radius info), most recently used first, shared
+ * by every Shell Generator in the process. Once the shells held take up more
+ * than the budget, the least recently used ones are dropped.
+ *
+ * The meshes are shared with whoever else has them, not copied, so holding a
+ * shell here costs nothing extra while it's still in use elsewhere.
+ */
+class shell_cache {
+public:
+  static shell_cache& get();
+  // Fills in `mesh` and `radius_info` and returns true if `key` is held.
+  bool find(const shell_cache_key& key, FBakedMesh& mesh,
+            TArray<FRadiusInfo>& radius_info);
+  void insert(const shell_cache_key& key, const FBakedMesh& mesh,
+              const TArray<FRadiusInfo>& radius_info);
+  void set_budget(uint64 bytes);
+  void clear();
+  shell_cache_stats stats();
+private:
+  struct entry {
+    shell_cache_key key;
+    FBakedMesh mesh;
+    TArray<FRadiusInfo> radius_info;
+    uint64 bytes;
+  };
+  typedef std::list<entry>::iterator entry_it;
+  std::mutex mutex;
+  std::list<entry> entries;
+  std::unordered_multimap<uint64, entry_it> by_hash;
+  uint64 budget = 256ull << 20;
+  uint64 bytes_held = 0;
+  uint64 hits = 0, misses = 0;
+  entry_it lookup(const shell_cache_key& key);
+  void evict_down_to(uint64 bytes);
+};
@@ -0,0 +1,170 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "shell_ring_sink.h"
+
+#include <cassert>
+
+void stitch_rings(std::vector<uint32_t>& indices,
+                  uint32_t a_start, unsigned int a_count,
+                  uint32_t b_start, unsigned int b_count) {
+  assert(a_count > 1 || b_count > 1);
+  if(a_count > 1 && b_count > 1) {
+    assert(a_count == b_count);
+    for(unsigned int i = 0; i < a_count; ++i) {
+      unsigned int next_i = (i+1) % a_count;
+      indices.push_back(a_start + i);
+      indices.push_back(a_start + next_i);
+      indices.push_back(b_start + next_i);
+      indices.push_back(a_start + i);
+      indices.push_back(b_start + next_i);
+      indices.push_back(b_start + i);
+    }
+  }
+  else if(b_count > 1) {
+    // a is the tip of the young endcap
+    for(unsigned int i = 0; i < b_count; ++i) {
+      unsigned int next_i = (i+1) % b_count;
+      indices.push_back(a_start);
+      indices.push_back(b_start + next_i);
+      indices.push_back(b_start + i);
+    }
+  }
+  else if(a_count > 1) {
+    // b is the tip of the old endcap
+    for(unsigned int i = 0; i < a_count; ++i) {
+      unsigned int next_i = (i+1) % a_count;
+      indices.push_back(a_start + i);
+      indices.push_back(a_start + next_i);
+      indices.push_back(b_start);
+    }
+  }
+}
+
+baked_mesh_sink::baked_mesh_sink()
+  : mesh(std::make_shared<std::vector<FVector>>(),
+         std::make_shared<std::vector<FVector2D>>(),
+         std::make_shared<std::vector<uint32_t>>()) {}
+
+void baked_mesh_sink::ring(const FVector* positions,
+                           const FVector2D* texcoords, unsigned int count) {
+  auto& vertices = *mesh.vertices;
+  uint32_t start = vertices.size();
+  vertices.insert(vertices.end(), positions, positions + count);
+  mesh.texcoords->insert(mesh.texcoords->end(), texcoords, texcoords + count);
+  if(last_count != 0) {
+    stitch_rings(*mesh.indices, last_start, last_count, start, count);
+  }
+  last_start = start;
+  last_count = count;
+}
+
+void normal_ring_sink::ring(const FVector* positions,
+                            const FVector2D* texcoords, unsigned int count) {
+  if(have_cur) flush(positions, texcoords, count);
+  std::swap(prev_positions, cur_positions);
+  std::swap(prev_texcoords, cur_texcoords);
+  have_prev = have_cur;
+  cur_positions.assign(positions, positions + count);
+  cur_texcoords.assign(texcoords, texcoords + count);
+  have_cur = true;
+}
+
+void normal_ring_sink::finish() {
+  if(have_cur) flush(nullptr, nullptr, 0);
+  have_prev = have_cur = false;
+  finish_with_normals();
+}
+
+void normal_ring_sink::flush(const FVector* next_positions,
+                             const FVector2D* next_texcoords,
+                             unsigned int next_count) {
+  /* Lay the (up to) three rings out in a row and stitch them together just
+     like baked_mesh_sink would. The triangles touching the middle ring are
+     exactly the ones that would touch it in the finished mesh, so we get the
+     same normals that FBakedMesh::calculate_normals would. */
+  unsigned int count = cur_positions.size();
+  window_positions.clear();
+  window_texcoords.clear();
+  window_indices.clear();
+  uint32_t cur_start = 0;
+  if(have_prev) {
+    window_positions.insert(window_positions.end(), prev_positions.begin(),
+                            prev_positions.end());
+    window_texcoords.insert(window_texcoords.end(), prev_texcoords.begin(),
+                            prev_texcoords.end());
+    cur_start = prev_positions.size();
+    stitch_rings(window_indices, 0, prev_positions.size(), cur_start, count);
+  }
+  window_positions.insert(window_positions.end(), cur_positions.begin(),
+                          cur_positions.end());
+  window_texcoords.insert(window_texcoords.end(), cur_texcoords.begin(),
+                          cur_texcoords.end());
+  if(next_count != 0) {
+    window_positions.insert(window_positions.end(), next_positions,
+                            next_positions + next_count);
+    window_texcoords.insert(window_texcoords.end(), next_texcoords,
+                            next_texcoords + next_count);
+    stitch_rings(window_indices, cur_start, count, cur_start + count,
+                 next_count);
+  }
+  FBakedMesh window(std::shared_ptr<std::vector<FVector>>
+                    (&window_positions, [](std::vector<FVector>*){}),
+                    std::shared_ptr<std::vector<FVector2D>>
+                    (&window_texcoords, [](std::vector<FVector2D>*){}),
+                    std::shared_ptr<std::vector<uint32_t>>
+                    (&window_indices, [](std::vector<uint32_t>*){}));
+  normals = window.calculate_normals();
+  const FVector2D* cur_footprints = nullptr;
+  if(wants_footprints) {
+    footprints = window.calculate_uv_footprints();
+    cur_footprints = footprints.data() + cur_start;
+  }
+  ring_with_normals(cur_positions.data(), cur_texcoords.data(),
+                    normals.data() + cur_start, cur_footprints, count);
+}
+
+distorting_ring_sink::distorting_ring_sink
+(shell_ring_sink& next, const std::vector<distortion_snapshot>& distortions)
+  : next(next), distortions(distortions) {
+  for(const auto& distortion : distortions) {
+    distortion.for_each_source([this](const distortion_source& source) {
+      if(source.filter_by_footprint) wants_footprints = true;
+    });
+  }
+}
+
+void distorting_ring_sink::ring_with_normals(const FVector* positions,
+                                             const FVector2D* texcoords,
+                                             const FVector* normals,
+                                             const FVector2D* footprints,
+                                             unsigned int count) {
+  amounts.assign(count, 0.0f);
+  temp.resize(count);
+  for(const auto& distortion : distortions) {
+    distortion.sample_many(texcoords, temp.data(), count, footprints);
+    for(unsigned int i = 0; i < count; ++i) amounts[i] += temp[i];
+  }
+  displaced.resize(count);
+  for(unsigned int i = 0; i < count; ++i) {
+    displaced[i] = positions[i] + normals[i] * amounts[i];
+  }
+  next.ring(displaced.data(), texcoords, count);
+}
@@ -0,0 +1,116 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <vector>
+#include "BakedMesh.h"
+#include "Distortion.h"
+
+/**
+ * Whatever the shell generator is feeding rings into. Rings arrive in order,
+ * young end first. A ring with only one point in it is the tip of an endcap.
+ */
+struct shell_ring_sink {
+  virtual ~shell_ring_sink() {}
+  virtual void ring(const FVector* positions, const FVector2D* texcoords,
+                    unsigned int count) = 0;
+  /** No more rings are coming. */
+  virtual void finish() {}
+  /** If this turns true, the generator stops early (and then finishes). */
+  virtual bool cancelled() const { return false; }
+};
+
+/**
+ * Append the triangles that join ring `a` (the older one, starting at vertex
+ * `a_start`) to ring `b`. Every sink that cares about triangles should use
+ * this, so that they all agree about what the mesh looks like.
+ */
+void stitch_rings(std::vector<uint32_t>& indices,
+                  uint32_t a_start, unsigned int a_count,
+                  uint32_t b_start, unsigned int b_count);
+
+/** Piles the rings up into an FBakedMesh. */
+struct baked_mesh_sink : public shell_ring_sink {
+  FBakedMesh mesh;
+  baked_mesh_sink();
+  void ring(const FVector* positions, const FVector2D* texcoords,
+            unsigned int count) override;
+private:
+  uint32_t last_start = 0;
+  unsigned int last_count = 0;
+};
+
+/**
+ * Base for sinks that need to know each ring's normals. A ring's normal
+ * depends on the ring after it, so this always hangs on to one ring until
+ * the next one shows up, then hands it to ring_with_normals. The normals
+ * (and UV footprints, if asked for) are exactly the ones
+ * FBakedMesh::calculate_normals (and calculate_uv_footprints) would give
+ * the finished mesh.
+ */
+struct normal_ring_sink : public shell_ring_sink {
+  void ring(const FVector* positions, const FVector2D* texcoords,
+            unsigned int count) override final;
+  void finish() override final;
+protected:
+  bool wants_footprints = false;
+  virtual void ring_with_normals(const FVector* positions,
+                                 const FVector2D* texcoords,
+                                 const FVector* normals,
+                                 const FVector2D* footprints,
+                                 unsigned int count) = 0;
+  virtual void finish_with_normals() {}
+private:
+  // The last two rings we were given.
+  std::vector<FVector> prev_positions, cur_positions;
+  std::vector<FVector2D> prev_texcoords, cur_texcoords;
+  bool have_prev = false, have_cur = false;
+  // scratch space, kept around so we aren't allocating for every ring
+  std::vector<FVector> window_positions, normals;
+  std::vector<FVector2D> window_texcoords, footprints;
+  std::vector<uint32_t> window_indices;
+  void flush(const FVector* next_positions, const FVector2D* next_texcoords,
+             unsigned int next_count);
+};
+
+/**
+ * Pushes every ring out along its normal by the given Distortions, then
+ * passes it on to `next`. Normals come from the undistorted shape.
+ *
+ * The result is the same as building the whole mesh and then calling
+ * UDistorter::ApplyDistortions on it.
+ */
+struct distorting_ring_sink : public normal_ring_sink {
+  distorting_ring_sink(shell_ring_sink& next,
+                       const std::vector<distortion_snapshot>& distortions);
+  bool cancelled() const override { return next.cancelled(); }
+protected:
+  void ring_with_normals(const FVector* positions, const FVector2D* texcoords,
+                         const FVector* normals, const FVector2D* footprints,
+                         unsigned int count) override;
+  void finish_with_normals() override { next.finish(); }
+private:
+  shell_ring_sink& next;
+  const std::vector<distortion_snapshot>& distortions;
+  std::vector<FVector> displaced;
+  std::vector<float> amounts, temp;
+};
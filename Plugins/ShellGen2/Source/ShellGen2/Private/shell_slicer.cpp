@@ -0,0 +1,261 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "shell_slicer.h"
+#include "bnlytmn.hpp"
+
+#include "Async/ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+  uint64 edge_key(uint32_t a, uint32_t b) {
+    if(a > b) std::swap(a, b);
+    return (uint64(a) << 32) | b;
+  }
+  // Where edge a-b crosses the plane at z. Always worked out from the
+  // lower-numbered end, so both triangles on the edge get the exact same
+  // point.
+  FVector2D edge_point(const FVector* pa, uint32_t a,
+                       const FVector* pb, uint32_t b, float z) {
+    if(a > b) std::swap(pa, pb);
+    float t = (z - pa->Z) / (pb->Z - pa->Z);
+    return FVector2D(pa->X + (pb->X - pa->X) * t,
+                     pa->Y + (pb->Y - pa->Y) * t);
+  }
+  void chain_layer(const std::vector<slice_segment>& segments,
+                   FSliceLayer& out, bool find_crossings) {
+    std::unordered_map<uint64, uint32_t> by_from;
+    std::unordered_set<uint64> to_edges;
+    by_from.reserve(segments.size());
+    to_edges.reserve(segments.size());
+    for(uint32_t n = 0; n < segments.size(); ++n) {
+      by_from.emplace(segments[n].from_edge, n);
+      to_edges.insert(segments[n].to_edge);
+    }
+    std::vector<bool> used(segments.size());
+    auto walk = [&](uint32_t start) {
+      FSliceContour contour;
+      contour.points.Add(segments[start].from);
+      uint32_t cur = start;
+      while(true) {
+        used[cur] = true;
+        auto it = by_from.find(segments[cur].to_edge);
+        if(it != by_from.end() && it->second == start) break;
+        contour.points.Add(segments[cur].to);
+        if(it == by_from.end() || used[it->second]) {
+          contour.closed = false;
+          break;
+        }
+        cur = it->second;
+      }
+      out.contours.Emplace(std::move(contour));
+    };
+    // Contours that run off the edge of the mesh have to be started from
+    // their beginnings...
+    for(uint32_t n = 0; n < segments.size(); ++n) {
+      if(!used[n] && to_edges.find(segments[n].from_edge) == to_edges.end())
+        walk(n);
+    }
+    // ...and then everything left is a loop.
+    for(uint32_t n = 0; n < segments.size(); ++n) {
+      if(!used[n]) walk(n);
+    }
+    if(find_crossings) {
+      TArray<LineSeg> lines;
+      lines.Reserve(segments.size());
+      for(auto& segment : segments) {
+        lines.Add(LineSeg{segment.from, segment.to});
+      }
+      out.crossings = bnlytmn(lines);
+    }
+  }
+}
+
+float slice_layer_z(float layer_height, int n) {
+  return float((n + 0.5) * double(layer_height));
+}
+
+void slice_layer_range(float layer_height, float min_z, float max_z,
+                       int& lo, int& hi) {
+  // One extra on each end, in case of rounding. slice_triangle makes the
+  // real decision.
+  lo = int(std::floor(min_z / layer_height - 0.5f));
+  hi = int(std::floor(max_z / layer_height - 0.5f)) + 1;
+}
+
+void slice_triangle(std::vector<slice_segment>& out, float z,
+                    const FVector& pa, const FVector& pb, const FVector& pc,
+                    uint32_t a, uint32_t b, uint32_t c) {
+  const FVector* p[3] = {&pa, &pb, &pc};
+  uint32_t v[3] = {a, b, c};
+  bool above[3] = {pa.Z >= z, pb.Z >= z, pc.Z >= z};
+  if(above[0] == above[1] && above[1] == above[2]) return;
+  // Going around the triangle, we cross the plane once going down and once
+  // coming back up. The segment runs from the first to the second; the
+  // triangle next door crosses the shared edge the other way, so its segment
+  // picks up where this one leaves off.
+  slice_segment segment;
+  for(int i = 0; i < 3; ++i) {
+    int j = (i + 1) % 3;
+    if(above[i] == above[j]) continue;
+    uint64 key = edge_key(v[i], v[j]);
+    FVector2D point = edge_point(p[i], v[i], p[j], v[j], z);
+    if(above[i]) {
+      segment.from_edge = key;
+      segment.from = point;
+    }
+    else {
+      segment.to_edge = key;
+      segment.to = point;
+    }
+  }
+  out.emplace_back(segment);
+}
+
+void slice_segments::cover(int lo, int hi) {
+  if(layers.empty()) {
+    first_layer = lo;
+    layers.resize(hi - lo + 1);
+    return;
+  }
+  if(lo < first_layer) {
+    layers.insert(layers.begin(), first_layer - lo,
+                  std::vector<slice_segment>());
+    first_layer = lo;
+  }
+  int last_layer = first_layer + int(layers.size()) - 1;
+  if(hi > last_layer) layers.resize(hi - first_layer + 1);
+}
+
+void slice_segments::add_triangles(const FVector* positions,
+                                   const uint32_t* indices,
+                                   size_t begin, size_t end,
+                                   uint32_t index_offset) {
+  for(size_t n = begin; n < end; ++n) {
+    uint32_t a = indices[n*3], b = indices[n*3+1], c = indices[n*3+2];
+    auto& pa = positions[a];
+    auto& pb = positions[b];
+    auto& pc = positions[c];
+    int lo, hi;
+    slice_layer_range(layer_height,
+                      std::min({pa.Z, pb.Z, pc.Z}),
+                      std::max({pa.Z, pb.Z, pc.Z}), lo, hi);
+    cover(lo, hi);
+    for(int layer_n = lo; layer_n <= hi; ++layer_n) {
+      slice_triangle(layer(layer_n), slice_layer_z(layer_height, layer_n),
+                     pa, pb, pc, a + index_offset, b + index_offset,
+                     c + index_offset);
+    }
+  }
+}
+
+TArray<FSliceLayer> chain_slices(slice_segments& segments,
+                                 bool find_crossings) {
+  std::vector<int> nonempty;
+  for(size_t n = 0; n < segments.layers.size(); ++n) {
+    if(!segments.layers[n].empty()) nonempty.push_back(n);
+  }
+  TArray<FSliceLayer> ret;
+  ret.SetNum(nonempty.size());
+  ParallelFor(nonempty.size(), [&](int32 n) {
+    int layer_n = nonempty[n];
+    ret[n].z = slice_layer_z(segments.layer_height,
+                             layer_n + segments.first_layer);
+    chain_layer(segments.layers[layer_n], ret[n], find_crossings);
+    // Done with these.
+    std::vector<slice_segment>().swap(segments.layers[layer_n]);
+  });
+  return ret;
+}
+
+TArray<FSliceLayer> slice_mesh(const FBakedMesh& mesh, float layer_height,
+                               bool find_crossings) {
+  slice_segments segments(layer_height);
+  if(!mesh.vertices || !mesh.indices || mesh.vertices->empty())
+    return TArray<FSliceLayer>();
+  const auto& vertices = *mesh.vertices;
+  const auto& indices = *mesh.indices;
+  size_t num_triangles = indices.size() / 3;
+  float min_z = vertices[0].Z, max_z = vertices[0].Z;
+  for(auto& vertex : vertices) {
+    min_z = std::min(min_z, vertex.Z);
+    max_z = std::max(max_z, vertex.Z);
+  }
+  int lo, hi;
+  slice_layer_range(layer_height, min_z, max_z, lo, hi);
+  segments.cover(lo, hi);
+  // Sort the triangles into buckets by layer, so that each layer only looks
+  // at the triangles that actually reach it.
+  std::vector<uint32_t> bucket_start(hi - lo + 2);
+  auto triangle_range = [&](size_t n, int& tri_lo, int& tri_hi) {
+    auto& pa = vertices[indices[n*3]];
+    auto& pb = vertices[indices[n*3+1]];
+    auto& pc = vertices[indices[n*3+2]];
+    slice_layer_range(layer_height, std::min({pa.Z, pb.Z, pc.Z}),
+                      std::max({pa.Z, pb.Z, pc.Z}), tri_lo, tri_hi);
+  };
+  for(size_t n = 0; n < num_triangles; ++n) {
+    int tri_lo, tri_hi;
+    triangle_range(n, tri_lo, tri_hi);
+    for(int layer_n = tri_lo; layer_n <= tri_hi; ++layer_n)
+      ++bucket_start[layer_n - lo + 1];
+  }
+  for(size_t n = 1; n < bucket_start.size(); ++n)
+    bucket_start[n] += bucket_start[n-1];
+  std::vector<uint32_t> buckets(bucket_start.back());
+  {
+    std::vector<uint32_t> next(bucket_start.begin(), bucket_start.end() - 1);
+    for(size_t n = 0; n < num_triangles; ++n) {
+      int tri_lo, tri_hi;
+      triangle_range(n, tri_lo, tri_hi);
+      for(int layer_n = tri_lo; layer_n <= tri_hi; ++layer_n)
+        buckets[next[layer_n - lo]++] = n;
+    }
+  }
+  ParallelFor(hi - lo + 1, [&](int32 bucket) {
+    float z = slice_layer_z(layer_height, bucket + lo);
+    auto& out = segments.layers[bucket];
+    for(uint32_t i = bucket_start[bucket]; i < bucket_start[bucket+1]; ++i) {
+      size_t n = buckets[i];
+      uint32_t a = indices[n*3], b = indices[n*3+1], c = indices[n*3+2];
+      slice_triangle(out, z, vertices[a], vertices[b], vertices[c], a, b, c);
+    }
+  });
+  return chain_slices(segments, find_crossings);
+}
+
+void slicing_ring_sink::ring(const FVector* positions,
+                             const FVector2D* texcoords,
+                             unsigned int count) {
+  window.insert(window.end(), positions, positions + count);
+  if(last_count != 0) {
+    band.clear();
+    stitch_rings(band, 0, last_count, last_count, count);
+    segments.add_triangles(window.data(), band.data(), 0, band.size() / 3,
+                           last_start);
+  }
+  window.erase(window.begin(), window.begin() + last_count);
+  last_start += last_count;
+  last_count = count;
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <vector>
+#include "BakedMesh.h"
+#include "SliceLayer.h"
+#include "shell_ring_sink.h"
+
+// Cutting a mesh into horizontal layers. Layer n is the plane
+// z = (n + 0.5) * layer_height, so every slicing of anything with the same
+// layer height lines up.
+//
+// Each triangle that straddles a plane gives one segment. The segment's ends
+// are named after the mesh edges they're on, and a segment always runs the
+// same way around its triangle, so the segments join up end to end into
+// contours without any floating point comparisons.
+
+struct slice_segment {
+  uint64 from_edge, to_edge;
+  FVector2D from, to;
+};
+
+/** Segments for a run of consecutive layers, starting at `first_layer`. */
+struct slice_segments {
+  float layer_height;
+  int first_layer = 0;
+  std::vector<std::vector<slice_segment>> layers;
+  slice_segments(float layer_height) : layer_height(layer_height) {}
+  /** Make sure layers `lo` through `hi` (inclusive) have somewhere to go. */
+  void cover(int lo, int hi);
+  std::vector<slice_segment>& layer(int n) { return layers[n - first_layer]; }
+  /**
+   * Cut triangles [begin, end) of `indices` with every plane they straddle.
+   * `positions[i]` is the position of vertex `i`, which the mesh as a whole
+   * calls `i + index_offset`.
+   */
+  void add_triangles(const FVector* positions, const uint32_t* indices,
+                     size_t begin, size_t end, uint32_t index_offset = 0);
+};
+
+/** Height of the plane for layer `n`. */
+float slice_layer_z(float layer_height, int n);
+
+/**
+ * Which layers something spanning these heights might straddle. (Errs on
+ * the side of too many.)
+ */
+void slice_layer_range(float layer_height, float min_z, float max_z,
+                       int& lo, int& hi);
+
+/**
+ * Add the segment (if any) where this triangle crosses the plane at `z` to
+ * `out`. `a`, `b` and `c` are the vertex indices of `pa`, `pb` and `pc`.
+ */
+void slice_triangle(std::vector<slice_segment>& out, float z,
+                    const FVector& pa, const FVector& pb, const FVector& pc,
+                    uint32_t a, uint32_t b, uint32_t c);
+
+/**
+ * Join up each layer's segments into contours, in parallel, and (if asked)
+ * find where they cross. Empty layers are left out.
+ */
+TArray<FSliceLayer> chain_slices(slice_segments& segments,
+                                 bool find_crossings);
+
+/** Slices a whole mesh, with all the layers done in parallel. */
+TArray<FSliceLayer> slice_mesh(const FBakedMesh& mesh, float layer_height,
+                               bool find_crossings);
+
+/**
+ * Slices a shell as it's generated. Only the last ring is kept; each new
+ * ring's band of triangles is only tried against the planes it spans.
+ */
+struct slicing_ring_sink : public shell_ring_sink {
+  slice_segments segments;
+  slicing_ring_sink(float layer_height) : segments(layer_height) {}
+  void ring(const FVector* positions, const FVector2D* texcoords,
+            unsigned int count) override;
+private:
+  std::vector<FVector> window;
+  std::vector<uint32_t> band;
+  uint32_t last_start = 0;
+  unsigned int last_count = 0;
+};
@@ -0,0 +1,43 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <memory>
+#include "BakedMesh.h"
+#include "MeshDescription.h"
+
+class UStaticMesh;
+
+// BakedMeshToStaticMesh, in two halves.
+
+/**
+ * Everything that doesn't touch a UObject, so any thread can do it. Returns
+ * null for a nulled out mesh.
+ */
+std::unique_ptr<FMeshDescription>
+make_mesh_description(const FBakedMesh& in, bool compute_tangents);
+/**
+ * The rest. Game thread only. One mesh description per LOD, best first. If
+ * `reuse` isn't null, it gets rebuilt instead of making a new StaticMesh.
+ */
+UStaticMesh* make_static_mesh(const TArray<const FMeshDescription*>& lods,
+                              UStaticMesh* reuse = nullptr);
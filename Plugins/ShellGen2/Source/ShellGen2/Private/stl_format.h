@@ -0,0 +1,45 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <memory>
+#include <string>
+
+// Pieces of STL files, for anybody writing one. (StlWriter.cpp has the
+// details.)
+
+static constexpr size_t STL_HEADER_SIZE = 84;
+static constexpr size_t STL_RECORD_SIZE = 50;
+static constexpr const char* ASCII_STL_FOOTER = "\nendsolid GeneratedShell\n";
+
+std::string ascii_stl_header(const TArray<FString>& comments);
+/** 80 bytes of banner, then the triangle count. */
+std::string binary_stl_header(uint32 num_triangles);
+void append_ascii_stl_facet(std::string& out, const FVector& a,
+                            const FVector& b, const FVector& c,
+                            const FTransform* transform);
+/** Writes exactly STL_RECORD_SIZE bytes at p, and advances p past them. */
+void encode_binary_stl_record(char*& p, const FVector& a, const FVector& b,
+                              const FVector& c, const FTransform* transform);
+/** Adds the extension to `filename` if needed and puts the result in path. */
+std::unique_ptr<IFileHandle> open_stl_file(const FString& filename,
+                                           FString& path);
@@ -0,0 +1,517 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "streaming_export.h"
+#include "fast_format.h"
+#include "glb_format.h"
+#include "mesh_export.h"
+#include "obj_format.h"
+#include "shell_ring_sink.h"
+#include "stl_format.h"
+#include "three_mf_format.h"
+#include "zip_writer.h"
+
+#include <algorithm>
+#include <functional>
+
+// Deflate the 3MF model once this much XML has piled up.
+static constexpr size_t MODEL_PIECE_SIZE = 1 << 20;
+
+namespace {
+  void advance(export_progress* progress, uint64 triangles) {
+    if(progress) progress->advance(triangles);
+  }
+
+  /**
+   * A temporary file, for the parts of a file format that have to come
+   * after something we don't know yet. Deleted when we're done with it.
+   */
+  class spool_file {
+    FString path;
+    std::unique_ptr<IFileHandle> handle;
+    std::unique_ptr<buffered_file_writer> writer;
+  public:
+    bool open(const FString& spool_path) {
+      path = spool_path;
+      IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+      handle.reset(PlatformFile.OpenWrite(*path));
+      if(!handle) return false;
+      writer = std::make_unique<buffered_file_writer>(*handle);
+      return true;
+    }
+    void write(const void* data, size_t length) {
+      writer->write(reinterpret_cast<const char*>(data), length);
+    }
+    /**
+     * Stop writing, and read the whole thing back `block_size` bytes at a
+     * time (except maybe the last block).
+     */
+    bool read_back(size_t block_size,
+                   const std::function<bool(const char*, size_t)>& block) {
+      if(!writer || !writer->flush()) return false;
+      writer = nullptr;
+      handle = nullptr;
+      IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+      std::unique_ptr<IFileHandle> in(PlatformFile.OpenRead(*path));
+      if(!in) return false;
+      std::vector<uint8> buffer(block_size);
+      int64 left = in->Size();
+      while(left > 0) {
+        int64 length = std::min<int64>(left, block_size);
+        if(!in->Read(buffer.data(), length)) return false;
+        if(!block(reinterpret_cast<const char*>(buffer.data()), length))
+          return false;
+        left -= length;
+      }
+      return true;
+    }
+    ~spool_file() {
+      writer = nullptr;
+      handle = nullptr;
+      if(!path.IsEmpty())
+        FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+    }
+  };
+
+  /**
+   * Keeps track of where each ring would be in the finished mesh, and which
+   * triangles it adds to it.
+   */
+  struct ring_stitcher {
+    uint64 next_vertex = 0;
+    uint64 last_start = 0;
+    unsigned int last_count = 0;
+    // The triangles that joined the last ring to the one before it.
+    std::vector<uint32_t> triangles;
+    // Set once there are more vertices than 32-bit indices can reach.
+    // Nothing gets stitched after that, and the export has to fail (see
+    // fail_overflowed) rather than write indices that wrapped around.
+    bool overflowed = false;
+    void add_ring(unsigned int count) {
+      triangles.clear();
+      if(overflowed || next_vertex + count > (uint64(1) << 32)) {
+        overflowed = true;
+        return;
+      }
+      if(last_count != 0)
+        stitch_rings(triangles, uint32_t(last_start), last_count,
+                     uint32_t(next_vertex), count);
+      last_start = next_vertex;
+      last_count = count;
+      next_vertex += count;
+    }
+  };
+
+  // For when a ring_stitcher overflowed: deletes the half-written file and
+  // says why.
+  bool fail_overflowed(std::unique_ptr<IFileHandle>& file, const FString& path,
+                       FString& failure_reason) {
+    file = nullptr;
+    FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+    failure_reason = "Too many vertices for 32-bit indices";
+    return false;
+  }
+
+  class stl_ring_sink : public shell_ring_sink {
+    bool ascii;
+    export_progress* progress;
+    FString path;
+    std::unique_ptr<IFileHandle> file;
+    std::unique_ptr<buffered_file_writer> o;
+    // the last ring, followed by this one
+    std::vector<FVector> window;
+    std::vector<uint32_t> window_indices;
+    unsigned int last_count = 0;
+    uint64 triangles = 0;
+    std::string out;
+  public:
+    stl_ring_sink(bool ascii, export_progress* progress)
+      : ascii(ascii), progress(progress) {}
+    bool open(const FString& filename, const TArray<FString>& comments,
+              FString& failure_reason) {
+      file = open_stl_file(filename, path);
+      if(!file) {
+        failure_reason = "Unable to write file";
+        return false;
+      }
+      o = std::make_unique<buffered_file_writer>(*file);
+      // (binary: we'll come back for the count)
+      o->write(ascii ? ascii_stl_header(comments) : binary_stl_header(0));
+      return true;
+    }
+    void ring(const FVector* positions, const FVector2D* texcoords,
+              unsigned int count) override {
+      window.insert(window.end(), positions, positions + count);
+      if(last_count != 0) {
+        window_indices.clear();
+        stitch_rings(window_indices, 0, last_count, last_count, count);
+        size_t num_triangles = window_indices.size() / 3;
+        out.clear();
+        if(!ascii) out.resize(num_triangles * STL_RECORD_SIZE);
+        char* p = ascii ? nullptr : &out[0];
+        for(size_t n = 0; n < window_indices.size(); n += 3) {
+          auto& a = window[window_indices[n]];
+          auto& b = window[window_indices[n+1]];
+          auto& c = window[window_indices[n+2]];
+          if(ascii) append_ascii_stl_facet(out, a, b, c, nullptr);
+          else encode_binary_stl_record(p, a, b, c, nullptr);
+        }
+        o->write(out);
+        triangles += num_triangles;
+        advance(progress, num_triangles);
+      }
+      window.erase(window.begin(), window.begin() + last_count);
+      last_count = count;
+    }
+    bool cancelled() const override {
+      return progress && progress->is_cancelled();
+    }
+    bool close(FString& failure_reason) {
+      if(ascii) {
+        o->write(ASCII_STL_FOOTER);
+      }
+      else if(o->flush()) {
+        // The one number in the file we didn't know at the start.
+        std::string header = binary_stl_header(uint32(triangles));
+        if(!file->Seek(STL_HEADER_SIZE - 4)
+           || !file->Write(reinterpret_cast<const uint8*>(header.data())
+                           + STL_HEADER_SIZE - 4, 4)) {
+          file = nullptr;
+          FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+          failure_reason = "Unable to write file";
+          return false;
+        }
+      }
+      return finish_export_file(file, *o, path, progress, failure_reason);
+    }
+  };
+
+  class obj_ring_sink : public shell_ring_sink {
+    export_progress* progress;
+    FString path;
+    std::unique_ptr<IFileHandle> file;
+    std::unique_ptr<buffered_file_writer> o;
+    ring_stitcher stitcher;
+    std::string out;
+  public:
+    obj_ring_sink(export_progress* progress) : progress(progress) {}
+    bool open(const FString& filename, const TArray<FString>& comments,
+              FString& failure_reason) {
+      file = open_obj_file(filename, path);
+      if(!file) {
+        failure_reason = "Unable to write file";
+        return false;
+      }
+      o = std::make_unique<buffered_file_writer>(*file);
+      o->write(obj_comment_header(comments));
+      return true;
+    }
+    void ring(const FVector* positions, const FVector2D* texcoords,
+              unsigned int count) override {
+      // OBJ doesn't mind faces showing up in between vertices, as long as
+      // they only use vertices that have already been seen.
+      out.clear();
+      for(unsigned int n = 0; n < count; ++n) {
+        append_obj_vertex(out, positions[n]);
+      }
+      for(unsigned int n = 0; n < count; ++n) {
+        append_obj_texcoord(out, texcoords[n]);
+      }
+      stitcher.add_ring(count);
+      const auto& indices = stitcher.triangles;
+      for(size_t n = 0; n < indices.size(); n += 3) {
+        append_obj_face(out, uint64(indices[n]) + 1, uint64(indices[n+1]) + 1,
+                        uint64(indices[n+2]) + 1);
+      }
+      o->write(out);
+      advance(progress, indices.size() / 3);
+    }
+    bool cancelled() const override {
+      // (an overflow stops generation early, too)
+      return stitcher.overflowed || (progress && progress->is_cancelled());
+    }
+    bool close(FString& failure_reason) {
+      if(stitcher.overflowed) return fail_overflowed(file, path, failure_reason);
+      return finish_export_file(file, *o, path, progress, failure_reason);
+    }
+  };
+
+  class three_mf_ring_sink : public shell_ring_sink {
+    export_progress* progress;
+    FString path;
+    std::unique_ptr<IFileHandle> file;
+    std::unique_ptr<buffered_file_writer> o;
+    std::unique_ptr<zip_writer> zip;
+    ring_stitcher stitcher;
+    // Vertices have to come before triangles. The triangles wait here.
+    spool_file triangle_spool;
+    uint64 triangles = 0;
+    std::string xml, deflated;
+    void write_xml(bool force) {
+      if(xml.size() < MODEL_PIECE_SIZE && !(force && !xml.empty())) return;
+      uint32 crc;
+      if(deflate_zip_piece(xml, deflated, crc))
+        zip->write_piece(deflated, crc, xml.size());
+      else
+        zip->fail();
+      xml.clear();
+    }
+  public:
+    three_mf_ring_sink(export_progress* progress) : progress(progress) {}
+    bool open(const FString& filename, const TArray<FString>& comments,
+              FString& failure_reason) {
+      file = open_3mf_file(filename, path);
+      if(!file) {
+        failure_reason = "Unable to write file";
+        return false;
+      }
+      if(!triangle_spool.open(path + TEXT(".triangles.part"))) {
+        // Don't leave the empty file we just made behind.
+        file = nullptr;
+        FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+        failure_reason = "Unable to write file";
+        return false;
+      }
+      o = std::make_unique<buffered_file_writer>(*file);
+      zip = std::make_unique<zip_writer>(*o);
+      begin_3mf_model(*zip, comments);
+      begin_3mf_object(*zip, 1, 0);
+      return true;
+    }
+    void ring(const FVector* positions, const FVector2D* texcoords,
+              unsigned int count) override {
+      for(unsigned int n = 0; n < count; ++n) {
+        append_3mf_vertex(xml, positions[n]);
+      }
+      write_xml(false);
+      stitcher.add_ring(count);
+      const auto& indices = stitcher.triangles;
+      triangle_spool.write(indices.data(), indices.size() * sizeof(uint32_t));
+      triangles += indices.size() / 3;
+      advance(progress, indices.size() / 3);
+    }
+    bool cancelled() const override {
+      // (an overflow stops generation early, too)
+      return stitcher.overflowed || (progress && progress->is_cancelled());
+    }
+    bool close(FString& failure_reason) {
+      if(stitcher.overflowed) return fail_overflowed(file, path, failure_reason);
+      write_xml(true);
+      begin_3mf_triangles(*zip);
+      bool spool_ok = triangles != 0 && triangle_spool.read_back
+        (sizeof(uint32_t) * 3 * 65536, [this](const char* data, size_t length) {
+          if(progress && progress->is_cancelled()) return false;
+          const uint32_t* indices = reinterpret_cast<const uint32_t*>(data);
+          for(size_t n = 0; n + 2 < length / sizeof(uint32_t); n += 3) {
+            append_3mf_triangle(xml, indices[n], indices[n+1], indices[n+2]);
+          }
+          write_xml(false);
+          return zip->ok();
+        });
+      write_xml(true);
+      end_3mf_object(*zip);
+      end_3mf_model(*zip, std::vector<int>{1}, TArray<FTransform>());
+      if(!spool_ok && !(progress && progress->is_cancelled())) {
+        failure_reason = triangles == 0 ? "The shell was empty"
+          : "Unable to write file";
+        file = nullptr;
+        FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+        return false;
+      }
+      return finish_3mf_file(*zip, file, *o, path, progress, failure_reason);
+    }
+  };
+
+  class glb_ring_sink : public normal_ring_sink {
+    export_progress* progress;
+    FString base_path;
+    ring_stitcher stitcher;
+    // Nothing can be written until the JSON is, and the JSON needs to know
+    // how much of everything there is. So everything gets spooled.
+    spool_file positions_spool, normals_spool, texcoords_spool, indices_spool;
+    glb_mesh_layout layout;
+    std::vector<FVector> unit_normals;
+  public:
+    glb_ring_sink(export_progress* progress) : progress(progress) {}
+    bool open(const FString& filename, FString& failure_reason) {
+      FString path;
+      auto file = open_glb_file(filename, path); // (make sure we can)
+      base_path = path;
+      if(!file) {
+        failure_reason = "Unable to write file";
+        return false;
+      }
+      if(!positions_spool.open(path + TEXT(".positions.part"))
+         || !normals_spool.open(path + TEXT(".normals.part"))
+         || !texcoords_spool.open(path + TEXT(".texcoords.part"))
+         || !indices_spool.open(path + TEXT(".indices.part"))) {
+        // Don't leave the empty file we just made behind.
+        file = nullptr;
+        FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+        failure_reason = "Unable to write file";
+        return false;
+      }
+      return true;
+    }
+    bool cancelled() const override {
+      // (an overflow stops generation early, too)
+      return stitcher.overflowed || (progress && progress->is_cancelled());
+    }
+    bool close(const TArray<FString>& comments, FString& failure_reason) {
+      if(stitcher.overflowed) {
+        std::unique_ptr<IFileHandle> no_file;
+        return fail_overflowed(no_file, base_path, failure_reason);
+      }
+      if(progress && progress->is_cancelled()) {
+        failure_reason = "Export was cancelled";
+        FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*base_path);
+        return false;
+      }
+      std::vector<glb_mesh_layout> layouts{layout};
+      int next_accessor = 0, next_mesh = 0;
+      uint64 bin_length = layout_glb_mesh(layouts[0], true, 0,
+                                          next_accessor, next_mesh);
+      std::string json = build_glb_json(comments, layouts,
+                                        TArray<FTransform>(), true,
+                                        bin_length);
+      // (base_path is already where open put the file. Going through
+      // open_glb_file again would cook it a second time.)
+      const FString& path = base_path;
+      std::unique_ptr<IFileHandle> file
+        (FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*path));
+      if(!finish_glb_json(json, bin_length, failure_reason)) {
+        file = nullptr;
+        FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+        return false;
+      }
+      if(!file) {
+        failure_reason = "Unable to write file";
+        return false;
+      }
+      buffered_file_writer o(*file);
+      o.write(glb_header(json.size(), bin_length));
+      o.write(json);
+      o.write(glb_bin_header(bin_length));
+      if(layouts[0].mesh_index >= 0) {
+        // in the same order layout_glb_mesh put them
+        auto copy = [&o](const char* data, size_t length) {
+          return o.write(data, length);
+        };
+        if(!positions_spool.read_back(1 << 20, copy)
+           || !normals_spool.read_back(1 << 20, copy)
+           || !texcoords_spool.read_back(1 << 20, copy)
+           || !indices_spool.read_back(1 << 20, copy)) {
+          file = nullptr;
+          FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*path);
+          failure_reason = "Unable to write file";
+          return false;
+        }
+      }
+      return finish_export_file(file, o, path, progress, failure_reason);
+    }
+  protected:
+    void ring_with_normals(const FVector* positions,
+                           const FVector2D* texcoords, const FVector* normals,
+                           const FVector2D* footprints,
+                           unsigned int count) override {
+      if(layout.vertex_count == 0 && count != 0) {
+        layout.min = layout.max = positions[0];
+      }
+      for(unsigned int n = 0; n < count; ++n) {
+        layout.min = layout.min.ComponentMin(positions[n]);
+        layout.max = layout.max.ComponentMax(positions[n]);
+      }
+      positions_spool.write(positions, count * sizeof(FVector));
+      unit_normals.assign(normals, normals + count);
+      make_glb_normals_unit(unit_normals.data(), count);
+      normals_spool.write(unit_normals.data(), count * sizeof(FVector));
+      texcoords_spool.write(texcoords, count * sizeof(FVector2D));
+      stitcher.add_ring(count);
+      const auto& indices = stitcher.triangles;
+      indices_spool.write(indices.data(), indices.size() * sizeof(uint32_t));
+      layout.vertex_count += count;
+      layout.index_count += indices.size();
+      advance(progress, indices.size() / 3);
+    }
+  };
+
+  template<class Sink>
+  void run_generator(const shell_params& params, const shell_curves& curves,
+                     const std::vector<distortion_snapshot>& distortions,
+                     Sink& sink) {
+    if(distortions.empty()) {
+      params.generate(curves, sink);
+    }
+    else {
+      distorting_ring_sink distorting_sink(sink, distortions);
+      params.generate(curves, distorting_sink);
+    }
+  }
+}
+
+bool generate_shell_to_file(const shell_params& params,
+                            const std::vector<distortion_snapshot>&
+                            distortions,
+                            ShellExportFormat format,
+                            const TArray<FString>& comments,
+                            const FString& filename, FString& failure_reason,
+                            export_progress* progress) {
+  auto curves = params.smoosh();
+  uint64 total = params.count_triangles(curves);
+  if(progress) progress->set_total(total);
+  switch(format) {
+  case ShellExportFormat::ExportObj: {
+    obj_ring_sink sink(progress);
+    if(!sink.open(filename, comments, failure_reason)) return false;
+    run_generator(params, curves, distortions, sink);
+    return sink.close(failure_reason);
+  }
+  case ShellExportFormat::ExportAsciiStl:
+  case ShellExportFormat::ExportBinaryStl: {
+    bool ascii = format == ShellExportFormat::ExportAsciiStl;
+    if(!ascii && total > 0xFFFFFFFFu) {
+      failure_reason = "Too many triangles for a binary STL file";
+      return false;
+    }
+    stl_ring_sink sink(ascii, progress);
+    if(!sink.open(filename, comments, failure_reason)) return false;
+    run_generator(params, curves, distortions, sink);
+    return sink.close(failure_reason);
+  }
+  case ShellExportFormat::ExportGlb: {
+    if(!PLATFORM_LITTLE_ENDIAN) {
+      failure_reason = "glTF export is only supported on little-endian machines";
+      return false;
+    }
+    glb_ring_sink sink(progress);
+    if(!sink.open(filename, failure_reason)) return false;
+    run_generator(params, curves, distortions, sink);
+    return sink.close(comments, failure_reason);
+  }
+  case ShellExportFormat::Export3mf: {
+    three_mf_ring_sink sink(progress);
+    if(!sink.open(filename, comments, failure_reason)) return false;
+    run_generator(params, curves, distortions, sink);
+    return sink.close(failure_reason);
+  }
+  }
+  failure_reason = "Unknown export format";
+  return false;
+}
@@ -0,0 +1,43 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <vector>
+#include "ShellExportJob.h"
+#include "ShellGenerator.h"
+
+struct export_progress;
+
+/**
+ * Generate the shell described by `params` (distorted by `distortions`, if
+ * there are any) straight into a file, one ring at a time. The whole mesh is
+ * never in memory at once: STL and OBJ are written as the rings arrive, and
+ * the parts of glTF and 3MF files that have to come later get spooled to
+ * temporary files next to the output.
+ */
+bool generate_shell_to_file(const shell_params& params,
+                            const std::vector<distortion_snapshot>&
+                            distortions,
+                            ShellExportFormat format,
+                            const TArray<FString>& comments,
+                            const FString& filename, FString& failure_reason,
+                            export_progress* progress = nullptr);
@@ -0,0 +1,60 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class buffered_file_writer;
+class zip_writer;
+struct export_progress;
+
+// Pieces of 3MF files, for anybody writing one. (ThreeMFWriter.cpp has the
+// details.) The model goes:
+//
+//   begin_3mf_model
+//   for each object:
+//     begin_3mf_object, vertices, begin_3mf_triangles, triangles,
+//     end_3mf_object
+//   end_3mf_model
+//   finish_3mf_file
+
+/** Adds the extension to `filename` if needed and puts the result in path. */
+std::unique_ptr<IFileHandle> open_3mf_file(const FString& filename,
+                                           FString& path);
+void begin_3mf_model(zip_writer& zip, const TArray<FString>& comments);
+void begin_3mf_object(zip_writer& zip, int object_id, int mesh_number);
+void begin_3mf_triangles(zip_writer& zip);
+void end_3mf_object(zip_writer& zip);
+void append_3mf_vertex(std::string& out, const FVector& vertex);
+void append_3mf_triangle(std::string& out, uint32 a, uint32 b, uint32 c);
+/**
+ * `object_ids` has one entry per mesh: its object's id, or 0 if it was
+ * skipped. Any mesh with a transform gets it on its build item.
+ */
+void end_3mf_model(zip_writer& zip, const std::vector<int>& object_ids,
+                   const TArray<FTransform>& transforms);
+/** Like finish_export_file, but also fails if the ZIP got too big. */
+bool finish_3mf_file(const zip_writer& zip, std::unique_ptr<IFileHandle>& file,
+                     buffered_file_writer& o, const FString& path,
+                     export_progress* progress, FString& failure_reason);
@@ -0,0 +1,174 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "zip_writer.h"
+#include "fast_format.h"
+
+#include "zlib.h"
+
+// Every entry claims to have been made at midnight, January 1st, 1980. Being
+// reproducible is more useful than being accurate here.
+static constexpr uint16 DOS_TIME = 0;
+static constexpr uint16 DOS_DATE = (0 << 9) | (1 << 5) | 1;
+static constexpr uint16 ZIP_VERSION = 20; // 2.0: deflate
+static constexpr uint16 FLAG_DATA_DESCRIPTOR = 1 << 3;
+static constexpr uint16 METHOD_DEFLATE = 8;
+
+static void append_u16(std::string& out, uint16 value) {
+  out += char(value & 0xFF);
+  out += char(value >> 8);
+}
+
+static void append_u32(std::string& out, uint32 value) {
+  append_u16(out, value & 0xFFFF);
+  append_u16(out, value >> 16);
+}
+
+bool deflate_zip_piece(const std::string& in, std::string& out, uint32& crc) {
+  z_stream stream = {};
+  // negative window bits: raw deflate, no zlib header or trailer
+  if(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                  Z_DEFAULT_STRATEGY) != Z_OK) {
+    out.clear();
+    return false;
+  }
+  out.resize(deflateBound(&stream, in.size()) + 16);
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  stream.avail_in = in.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = out.size();
+  // Z_SYNC_FLUSH ends on a byte boundary without ending the stream, so the
+  // next piece can start right after it.
+  // (deflateBound promises the room, so anything short of using it all up
+  // is a failure.)
+  int result = deflate(&stream, Z_SYNC_FLUSH);
+  bool ok = result == Z_OK && stream.avail_in == 0;
+  out.resize(ok ? out.size() - stream.avail_out : 0);
+  deflateEnd(&stream);
+  crc = crc32(0, reinterpret_cast<const Bytef*>(in.data()), in.size());
+  return ok;
+}
+
+void zip_writer::write_raw(const std::string& data) {
+  o.write(data);
+  offset += data.size();
+}
+
+void zip_writer::begin_entry(const std::string& name) {
+  check(!in_entry);
+  entry e;
+  e.name = name;
+  e.header_offset = offset;
+  if(offset > 0xFFFFFFFFu) too_big = true;
+  entries.push_back(e);
+  in_entry = true;
+  std::string header;
+  append_u32(header, 0x04034b50);
+  append_u16(header, ZIP_VERSION);
+  append_u16(header, FLAG_DATA_DESCRIPTOR);
+  append_u16(header, METHOD_DEFLATE);
+  append_u16(header, DOS_TIME);
+  append_u16(header, DOS_DATE);
+  append_u32(header, 0); // CRC, sizes: see data descriptor
+  append_u32(header, 0);
+  append_u32(header, 0);
+  append_u16(header, name.size());
+  append_u16(header, 0); // no extra field
+  header += name;
+  write_raw(header);
+}
+
+bool zip_writer::write_piece(const std::string& deflated, uint32 crc,
+                             uint64 size) {
+  check(in_entry);
+  auto& e = entries.back();
+  e.crc = crc32_combine(e.crc, crc, size);
+  e.size += size;
+  e.compressed_size += deflated.size();
+  write_raw(deflated);
+  return o.ok();
+}
+
+bool zip_writer::write(const std::string& data) {
+  std::string deflated;
+  uint32 crc;
+  if(!deflate_zip_piece(data, deflated, crc)) {
+    failed = true;
+    return false;
+  }
+  return write_piece(deflated, crc, data.size());
+}
+
+bool zip_writer::end_entry() {
+  check(in_entry);
+  in_entry = false;
+  auto& e = entries.back();
+  // An empty, final, fixed-Huffman block. This is what finally ends the
+  // deflate stream that all the sync-flushed pieces started.
+  std::string trailer("\x03\x00", 2);
+  e.compressed_size += trailer.size();
+  if(e.size > 0xFFFFFFFFu || e.compressed_size > 0xFFFFFFFFu) too_big = true;
+  append_u32(trailer, 0x08074b50);
+  append_u32(trailer, e.crc);
+  append_u32(trailer, e.compressed_size);
+  append_u32(trailer, e.size);
+  write_raw(trailer);
+  return o.ok();
+}
+
+bool zip_writer::finish() {
+  check(!in_entry);
+  uint64 directory_offset = offset;
+  std::string directory;
+  for(const auto& e : entries) {
+    append_u32(directory, 0x02014b50);
+    append_u16(directory, ZIP_VERSION); // made by
+    append_u16(directory, ZIP_VERSION); // needed to extract
+    append_u16(directory, FLAG_DATA_DESCRIPTOR);
+    append_u16(directory, METHOD_DEFLATE);
+    append_u16(directory, DOS_TIME);
+    append_u16(directory, DOS_DATE);
+    append_u32(directory, e.crc);
+    append_u32(directory, e.compressed_size);
+    append_u32(directory, e.size);
+    append_u16(directory, e.name.size());
+    append_u16(directory, 0); // extra field
+    append_u16(directory, 0); // comment
+    append_u16(directory, 0); // disk number
+    append_u16(directory, 0); // internal attributes
+    append_u32(directory, 0); // external attributes
+    append_u32(directory, e.header_offset);
+    directory += e.name;
+  }
+  uint64 directory_size = directory.size();
+  if(directory_offset + directory_size > 0xFFFFFFFFu
+     || entries.size() > 0xFFFF)
+    too_big = true;
+  append_u32(directory, 0x06054b50);
+  append_u16(directory, 0); // this disk
+  append_u16(directory, 0); // disk with the directory
+  append_u16(directory, entries.size());
+  append_u16(directory, entries.size());
+  append_u32(directory, directory_size);
+  append_u32(directory, directory_offset);
+  append_u16(directory, 0); // comment
+  write_raw(directory);
+  return o.ok();
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <string>
+#include <vector>
+
+class buffered_file_writer;
+
+/**
+ * Just enough of a ZIP writer to make 3MF files: every entry is deflated,
+ * streamed out with a data descriptor after it (so we never need to seek
+ * back), and there's no ZIP64, so nothing may be bigger than 4GiB.
+ *
+ * Entry data can be deflated in pieces, in parallel, by deflate_zip_piece,
+ * and the pieces written in order. They're all "sync flushed", so gluing
+ * them together makes one valid deflate stream.
+ */
+class zip_writer {
+  buffered_file_writer& o;
+  struct entry {
+    std::string name;
+    uint32 crc = 0;
+    uint64 compressed_size = 0, size = 0;
+    uint64 header_offset = 0;
+  };
+  std::vector<entry> entries;
+  uint64 offset = 0;
+  bool in_entry = false;
+  bool too_big = false;
+  bool failed = false;
+  void write_raw(const std::string& data);
+public:
+  zip_writer(buffered_file_writer& o) : o(o) {}
+  void begin_entry(const std::string& name);
+  /**
+   * Add a piece that came out of deflate_zip_piece. `crc` and `size` are
+   * the CRC-32 and length of the piece before it was deflated.
+   */
+  bool write_piece(const std::string& deflated, uint32 crc, uint64 size);
+  /** Deflate `data` and add it. For the little entries. */
+  bool write(const std::string& data);
+  bool end_entry();
+  /** Write the central directory. The ZIP file is complete after this. */
+  bool finish();
+  /** False if some offset or size didn't fit in 32 bits. */
+  bool fits() const { return !too_big; }
+  /**
+   * Note that something meant for this file (like a piece that couldn't be
+   * deflated) never made it in.
+   */
+  void fail() { failed = true; }
+  /** False if anything failed to deflate or to write. */
+  bool ok() const { return !failed && o.ok(); }
+};
+
+/**
+ * Deflate `in` into `out` (replacing what's there) so it can be handed to
+ * zip_writer::write_piece, and put the CRC-32 of `in` in `crc`. Thread-safe.
+ * Returns false if zlib couldn't do it.
+ */
+bool deflate_zip_piece(const std::string& in, std::string& out, uint32& crc);
@@ -32,6 +32,22 @@ struct SHELLGEN2_API FBakedMesh {
   std::shared_ptr<std::vector<FVector2D> > texcoords;
   std::shared_ptr<std::vector<uint32_t> > indices;
   std::vector<FVector> calculate_normals() const;
+  /**
+   * For each vertex, the largest distance in U and in V between it and any
+   * vertex it shares an edge with. Distortions use this to decide how blurry
+   * a mip level they can get away with.
+   */
+  std::vector<FVector2D> calculate_uv_footprints() const;
+  /**
+   * For each vertex, the normal, tangent and binormal sign that
+   * build_tangent_space gives it. If `with_tangents` is false, only the
+   * normals are worked out properly, and the tangents are just any direction
+   * perpendicular to them (fine if nothing is going to be normal mapped).
+   */
+  void calculate_tangent_space(std::vector<FVector>& normals,
+                               std::vector<FVector>& tangents,
+                               std::vector<float>& binormal_signs,
+                               bool with_tangents = true) const;
   void build_tangent_space(const TArray<FVertexInstanceID>& viid_map,
                            TMeshAttributesRef<FVertexInstanceID, FVector>&
                            normals,
@@ -38,4 +38,35 @@ public:
   UFUNCTION(BlueprintCallable, Category="Morph Baker")
   static FBakedMesh ApplyDistortions(const FBakedMesh& mesh,
                                      const TArray<UDistortion*>& distorts);
+  /**
+   * Make a new Distorter, for use with ApplyDistortionsCached.
+   */
+  UFUNCTION(BlueprintCallable, Category="Morph Baker")
+  static UDistorter* MakeDistorter();
+  /**
+   * Same as ApplyDistortions, but remembers the normals and the (unscaled)
+   * samples from each map. If only Magnitude and MagnitudeOffset changed
+   * since the last call with the same mesh, nothing gets resampled.
+   */
+  UFUNCTION(BlueprintCallable, Category="Morph Baker")
+  FBakedMesh ApplyDistortionsCached(const FBakedMesh& mesh,
+                                    const TArray<UDistortion*>& distorts);
+  /**
+   * Forget everything ApplyDistortionsCached remembered.
+   */
+  UFUNCTION(BlueprintCallable, Category="Morph Baker")
+  void ClearDistortionCache();
+private:
+  // The mesh the cache belongs to. (Holding on to these also guarantees that
+  // nobody else gets the same addresses while we're comparing them.)
+  std::shared_ptr<std::vector<FVector> > cached_vertices;
+  std::shared_ptr<std::vector<FVector2D> > cached_texcoords;
+  std::shared_ptr<std::vector<uint32_t> > cached_indices;
+  std::vector<FVector> cached_normals;
+  std::vector<FVector2D> cached_footprints;
+  struct cached_field {
+    distortion_source source;
+    std::vector<float> values;
+  };
+  std::vector<cached_field> cached_fields;
 };
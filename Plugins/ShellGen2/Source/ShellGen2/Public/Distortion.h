@@ -20,10 +20,69 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
 #include "LoadedGrayPNG.h"
 #include "ComposeOperation.h"
+#include "ornament_spec.h"
 #include "Distortion.generated.h"
 
+/**
+ * Everything about a Distortion that decides which values get sampled, but
+ * not how they get scaled afterward. Two Distortions with equal sources
+ * sample exactly the same (unscaled) values.
+ */
+struct SHELLGEN2_API distortion_source {
+  // Exactly one of these is set.
+  std::shared_ptr<loaded_gray_png> image;
+  std::shared_ptr<const ornament_spec> ornament;
+  FVector2D uv_scale = FVector2D(1.0f, 1.0f);
+  FVector2D uv_offset = FVector2D(0.0f, 0.0f);
+  bool wrap_at_v = false;
+  bool filter_by_footprint = false;
+  bool operator==(const distortion_source& other) const {
+    return image == other.image
+      && (ornament == other.ornament
+          || (ornament && other.ornament && *ornament == *other.ornament))
+      && uv_scale == other.uv_scale
+      && uv_offset == other.uv_offset && wrap_at_v == other.wrap_at_v
+      && filter_by_footprint == other.filter_by_footprint;
+  }
+  bool valid() const { return image || ornament; }
+  /**
+   * Sample the map, without applying any magnitude. `footprints` is as in
+   * UDistortion::sample_many.
+   */
+  void sample_many(const FVector2D* uvs, float* out, size_t count,
+                   const FVector2D* footprints) const;
+};
+
+/**
+ * A Distortion, and everything it's composed with, copied out into plain C++.
+ * Doesn't need the UObjects to stay put, so it's safe to keep around.
+ */
+struct SHELLGEN2_API distortion_snapshot {
+  distortion_source source;
+  float magnitude = 1.0f;
+  float magnitude_offset = 0.0f;
+  std::vector<std::pair<ComposeOperation, distortion_snapshot> > composed;
+  /** Same as UDistortion::sample_many. */
+  void sample_many(const FVector2D* uvs, float* out, size_t count,
+                   const FVector2D* footprints) const;
+  /**
+   * Like sample_many, but instead of sampling, gets the unscaled samples for
+   * each source from `field_for`, which must return an array with at least
+   * `count` elements.
+   */
+  void apply_many(const std::function<const float*(const distortion_source&)>&
+                  field_for, float* out, size_t count) const;
+  /** Calls `visit` on the source of this and everything composed with it. */
+  void for_each_source(const std::function<void(const distortion_source&)>&
+                       visit) const;
+};
+
 /**
  * Used by the Distortion Baker. This associates a PNG displacement map with
  * scaling factors.
@@ -60,6 +119,11 @@ class SHELLGEN2_API UDistortion : public UObject {
    * mirror.
    */
   UPROPERTY() bool WrapAtV = false;
+  /**
+   * If true, and the distorted mesh is coarse compared to the map, sample a
+   * blurrier mip level instead of aliasing.
+   */
+  UPROPERTY() bool FilterByFootprint = false;
   /**
    * Other distortions to compose with this one.
    */
@@ -70,11 +134,23 @@ class SHELLGEN2_API UDistortion : public UObject {
   UPROPERTY() TArray<ComposeOperation> Operation;
   /* Why the !@#$ can I not pass parameters to NewObject<...>()!?!! */
   UDistortion() {}
+  virtual ~UDistortion() {}
+  /**
+   * True if this Distortion has something to sample. (For a plain
+   * Distortion, that means it has a Map.)
+   */
+  virtual bool has_source() const { return Map != nullptr; }
+  /**
+   * Sample whatever this Distortion samples, at already scaled, offset, and
+   * mirrored UVs.
+   */
+  virtual float sample_source(const FVector2D& uvscaled) {
+    return Map->GetImage()->sample(uvscaled.X, uvscaled.Y);
+  }
   float sample(const FVector2D& uv) {
-    const auto& png = Map->GetImage();
     auto uvscaled = uv * UVScale + UVOffset;
     if(!WrapAtV && uvscaled.Y < 0.0f) uvscaled.Y *= -1.0f;
-    auto sample = png->sample(uvscaled.X, uvscaled.Y);
+    auto sample = sample_source(uvscaled);
     auto ret = sample * Magnitude + MagnitudeOffset;
     for(int i = 0; i < ComposeWith.Num(); ++i) {
       switch(Operation[i]) {
@@ -91,4 +167,21 @@ class SHELLGEN2_API UDistortion : public UObject {
     }
     return ret;
   }
+  /**
+   * Sample many points at once. Same results as calling `sample` on each of
+   * them, only faster.
+   *
+   * `footprints`, if not null, gives the UV distance from each point to its
+   * neighbours (see FBakedMesh::calculate_uv_footprints). It's only used by
+   * Distortions with FilterByFootprint set.
+   */
+  void sample_many(const FVector2D* uvs, float* out, size_t count,
+                   const FVector2D* footprints = nullptr);
+  /**
+   * True if this Distortion, or one it's composed with, would make use of
+   * footprints.
+   */
+  bool wants_footprints() const;
+  virtual distortion_source get_source() const;
+  distortion_snapshot snapshot() const;
 };
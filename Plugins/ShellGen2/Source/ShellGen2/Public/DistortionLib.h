@@ -29,7 +29,8 @@ class SHELLGEN2_API UDistortionLib : public UBlueprintFunctionLibrary {
   GENERATED_UCLASS_BODY()
   /**
    * Create a new Distortion with the given displacement map, UV scale factors,
-   * and magnitude.
+   * and magnitude. If FilterByFootprint is set, coarse meshes will sample
+   * smaller mip levels of the map instead of aliasing.
    */
   UFUNCTION(BlueprintPure, meta = (Keywords = "construct build",
                                    NativeMakeFunc),
@@ -40,7 +41,29 @@ class SHELLGEN2_API UDistortionLib : public UBlueprintFunctionLibrary {
                                      FVector2D UVOffset= FVector2D(0.0f, 0.0f),
                                      float Magnitude = 1.0f,
                                      float MagnitudeOffset = 0.0f,
-				     bool WrapAtV = false);
+				     bool WrapAtV = false,
+				     bool FilterByFootprint = false);
+  /**
+   * Create a new Distortion that needs no map: ribs around the tube, nodes
+   * on the ribs, and spiral cords along the shell, all computed exactly from
+   * the shell's texture coordinates. Set a feature's height to zero to turn
+   * it off.
+   */
+  UFUNCTION(BlueprintPure, meta = (Keywords = "construct build rib spine node ornament"),
+            Category = "Shell Shape Generator")
+  static UDistortion* MakeOrnamentDistortion(float RibsPerWhorl = 24.0f,
+                                             float RibSharpness = 4.0f,
+                                             float RibHeight = 1.0f,
+                                             float NodesAcrossSection = 0.0f,
+                                             float NodeSharpness = 8.0f,
+                                             float NodeHeight = 0.0f,
+                                             float SpiralCords = 0.0f,
+                                             float SpiralTwistPerWhorl = 0.0f,
+                                             float SpiralSharpness = 2.0f,
+                                             float SpiralHeight = 0.0f,
+                                             float Magnitude = 1.0f,
+                                             float MagnitudeOffset = 0.0f,
+                                             bool WrapAtV = false);
   /**
    * Compose two Distortions together. Returns a Distortion that will apply the
    * requested operation to the results two passed-in Distortions and apply the
@@ -25,9 +25,17 @@
 #include "loaded_gray_png.h"
 #include "LoadedGrayPNG.generated.h"
 
+class ULoadedGrayPNG;
+
+DECLARE_DYNAMIC_DELEGATE_OneParam(FGrayPNGsLoaded,
+                                  const TArray<ULoadedGrayPNG*>&, Maps);
+
 /**
  * An object that encapsulates a loaded grayscale PNG image, suitable for use
  * as a displacement map.
+ *
+ * Decoded images are shared: loading the same (unchanged) file again while
+ * the first one is still alive doesn't decode it again.
  */
 UCLASS(BlueprintType, Category = "Shell Shape Generator")
 class SHELLGEN2_API ULoadedGrayPNG : public UObject {
@@ -38,9 +46,30 @@ class SHELLGEN2_API ULoadedGrayPNG : public UObject {
   /**
    * Attempts to load a grayscale PNG. Make sure the resulting reference isn't
    * null before trying to use it!
+   *
+   * If UseDiskCache is true, the decoded image is also saved next to the PNG
+   * (as .graycache), and later loads map that file instead of decoding the
+   * PNG again.
+   */
+  UFUNCTION(BlueprintCallable, Category="Shell Shape Generator")
+  static ULoadedGrayPNG* LoadGrayPNG(const FString& path,
+                                     bool UseDiskCache = false);
+  /**
+   * Loads several grayscale PNGs in the background, decoding them in
+   * parallel. OnLoaded is called on the game thread when they're all done,
+   * with the Maps in the same order as the paths. Any that failed to load
+   * will be null.
    */
   UFUNCTION(BlueprintCallable, Category="Shell Shape Generator")
-  static ULoadedGrayPNG* LoadGrayPNG(const FString& path);
+  static void LoadGrayPNGsAsync(const TArray<FString>& paths,
+                                FGrayPNGsLoaded OnLoaded,
+                                bool UseDiskCache = false);
+  /**
+   * Thread-safe part of LoadGrayPNG. Returns an already-decoded image if
+   * there is one, otherwise decodes the file.
+   */
+  static std::shared_ptr<loaded_gray_png> acquire_image(const FString& path,
+                                                        bool use_disk_cache);
  public:
   const std::shared_ptr<loaded_gray_png>& GetImage() const { return image; }
 };
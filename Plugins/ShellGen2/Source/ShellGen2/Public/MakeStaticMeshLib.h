@@ -23,12 +23,53 @@
 #include "BakedMesh.h"
 #include "MakeStaticMeshLib.generated.h"
 
+class UStaticMeshComponent;
+
+DECLARE_DYNAMIC_DELEGATE_OneParam(FStaticMeshReady, UStaticMesh*, Mesh);
+
 UCLASS(meta=(BlueprintThreadSafe), Category = "Shell Shape Generator")
 class UMakeStaticMeshLib : public UBlueprintFunctionLibrary {
   GENERATED_UCLASS_BODY()
   /**
    * Process a BakedMesh into a StaticMesh.
+   *
+   * If the material doesn't use a normal map, untick "Compute tangents" to
+   * skip working out proper tangents, which saves a good chunk of the time
+   * this takes.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  static UStaticMesh* BakedMeshToStaticMesh(const FBakedMesh& in,
+                                            UPARAM(DisplayName="Compute tangents")
+                                            bool compute_tangents = true);
+  /**
+   * Like BakedMeshToStaticMesh, but most of the work (everything except
+   * making the StaticMesh itself and building its render data) happens on a
+   * worker thread, so editing a shell doesn't freeze the game while it
+   * happens. OnReady gets the StaticMesh (or None, if the mesh was nulled
+   * out) on the game thread.
+   *
+   * If you start another one before this one is done, they can finish in
+   * either order.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  static void BeginBakedMeshToStaticMesh(const FBakedMesh& in,
+                                         UPARAM(DisplayName="Compute tangents")
+                                         bool compute_tangents,
+                                         FStaticMeshReady OnReady);
+  /**
+   * Put a BakedMesh on a StaticMeshComponent, reusing the StaticMesh that's
+   * already there (if it came from BakedMeshToStaticMesh or from here)
+   * instead of making a new one every time.
+   *
+   * If the new mesh has exactly the same triangles as the old one (which it
+   * does after most edits that don't change the shell's resolution or age),
+   * only the vertex data gets replaced, and the existing render buffers are
+   * refilled from it. Otherwise the StaticMesh is rebuilt in place. Either
+   * way, every component using the StaticMesh sees the change.
    */
   UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
-  static UStaticMesh* BakedMeshToStaticMesh(const FBakedMesh& in);
+  static void UpdateStaticMeshComponent(UStaticMeshComponent* component,
+                                        const FBakedMesh& in,
+                                        UPARAM(DisplayName="Compute tangents")
+                                        bool compute_tangents = true);
 };
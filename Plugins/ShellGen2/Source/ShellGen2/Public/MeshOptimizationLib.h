@@ -0,0 +1,75 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BakedMesh.h"
+#include "MeshOptimizationLib.generated.h"
+
+/**
+ * How much work the GPU's vertex shader does per triangle and per vertex,
+ * judged by a simulated 16-vertex post-transform cache.
+ */
+USTRUCT(BlueprintType, Category = "Shell Shape Generator")
+struct SHELLGEN2_API FVertexCacheStats {
+  GENERATED_BODY()
+  /** Average cache miss ratio (vertex shader runs per triangle). Lower is
+      better; 0.5 is about as good as it gets. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float acmr = 0.0f;
+  /** Average transform to vertex ratio (vertex shader runs per vertex).
+      Lower is better; 1.0 is perfect. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float atvr = 0.0f;
+  FVertexCacheStats() {}
+};
+
+UCLASS(meta=(BlueprintThreadSafe), Category = "Shell Shape Generator")
+class SHELLGEN2_API UMeshOptimizationLib : public UBlueprintFunctionLibrary {
+  GENERATED_UCLASS_BODY()
+  /**
+   * Reorder a BakedMesh's triangles so the GPU's vertex cache gets more use,
+   * then its vertices so they get fetched in order. The result looks exactly
+   * the same, and is cheaper to draw. Do this before making a StaticMesh or
+   * exporting. (Do it AFTER applying Distortions, since they don't care
+   * about the order but do cost a pass over the mesh.)
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  static FBakedMesh OptimizeMeshForRendering(const FBakedMesh& in,
+                                             FVertexCacheStats& before,
+                                             FVertexCacheStats& after);
+  /**
+   * Reduce the number of triangles in a BakedMesh while keeping its shape as
+   * well as possible, e.g. for LODs or lightweight exports of heavily
+   * distorted shells (where generating the shell again at a lower resolution
+   * would lose the detail).
+   *
+   * Stops when there are no more than TargetTriangles triangles left, or
+   * when going further would move the surface by more than MaxError (on
+   * average) — whichever happens first. Set either to 0 to go by the other
+   * one alone.
+   *
+   * The texture seam, endcap tips and any open edges stay exactly where they
+   * are.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  static FBakedMesh SimplifyMesh(const FBakedMesh& in,
+                                 int32 TargetTriangles = 0,
+                                 float MaxError = 0.0f);
+};
@@ -0,0 +1,85 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Distortion.h"
+#include "OrnamentDistortion.generated.h"
+
+/**
+ * A Distortion that doesn't need a map. Ribs, nodes, and spiral cords are
+ * worked out directly from the shell's texture coordinates, so they stay
+ * crisp at any resolution and take up no texture memory. Composes with
+ * other Distortions just like a map-based one.
+ */
+UCLASS(BlueprintType, Category = "Shell Shape Generator")
+class SHELLGEN2_API UOrnamentDistortion : public UDistortion {
+  GENERATED_BODY()
+ public:
+  /**
+   * How many ribs per whorl. Ribs run around the tube, like growth lines.
+   */
+  UPROPERTY() float RibsPerWhorl = 0.0f;
+  /**
+   * Higher numbers make narrower ribs with wider gaps between them.
+   */
+  UPROPERTY() float RibSharpness = 1.0f;
+  /**
+   * Height of the ribs, before Magnitude is applied.
+   */
+  UPROPERTY() float RibHeight = 0.0f;
+  /**
+   * How many rows of nodes (bumps on the ribs) there are across the cross
+   * section, counting from the middle of the cross section outward.
+   */
+  UPROPERTY() float NodesAcrossSection = 0.0f;
+  /**
+   * Higher numbers make smaller, pointier nodes.
+   */
+  UPROPERTY() float NodeSharpness = 1.0f;
+  /**
+   * Height of the nodes, before Magnitude is applied.
+   */
+  UPROPERTY() float NodeHeight = 0.0f;
+  /**
+   * How many spiral cords there are across the cross section. Cords run
+   * along the shell, crossing the ribs.
+   */
+  UPROPERTY() float SpiralCords = 0.0f;
+  /**
+   * How far the cords wind around the cross section per whorl. Zero makes
+   * them run straight along the shell.
+   */
+  UPROPERTY() float SpiralTwistPerWhorl = 0.0f;
+  /**
+   * Higher numbers make thinner cords.
+   */
+  UPROPERTY() float SpiralSharpness = 1.0f;
+  /**
+   * Height of the cords, before Magnitude is applied.
+   */
+  UPROPERTY() float SpiralHeight = 0.0f;
+  UOrnamentDistortion() {}
+  virtual bool has_source() const override { return true; }
+  virtual float sample_source(const FVector2D& uvscaled) override;
+  virtual distortion_source get_source() const override;
+  ornament_spec get_spec() const;
+};
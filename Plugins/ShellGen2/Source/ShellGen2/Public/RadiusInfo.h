@@ -20,6 +20,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include <vector>
+#include <memory>
 #include "RadiusInfo.generated.h"
 
 USTRUCT(BlueprintType, Category = "Shell Shape Generator")
@@ -34,7 +36,26 @@ struct SHELLGEN2_API FRadiusInfo {
       at the given theta. **/
   UPROPERTY(EditAnywhere, BlueprintReadWrite)float tube_binormal_radius;
   /** Cross section at the given theta, untransformed and centered around
-      0,0. */
+      0,0. Only filled in if the Shell Generator was told to copy cross
+      sections (see SetCopyCrossSections); otherwise use the functions in
+      RadiusInfoLib, which read it without copying. Anything you put in here
+      yourself takes the place of the generated cross section, for
+      RadiusInfoLib too. */
   UPROPERTY(EditAnywhere, BlueprintReadWrite) TArray<FVector> cross_section;
+  /* Every cross section from one generation, end to end, shared by all of
+     its FRadiusInfos. Never changes once it's made, so copying an
+     FRadiusInfo around is cheap. */
+  std::shared_ptr<const std::vector<FVector> > cross_sections;
+  uint32 cross_section_start = 0, cross_section_count = 0;
+  /** This one's cross section, without copying it: `cross_section` if it
+      has anything in it (copied in, or set from Blueprint), otherwise this
+      one's part of the shared buffer. */
+  TArrayView<const FVector> get_cross_section() const {
+    if(cross_sections == nullptr || cross_section.Num() != 0)
+      return TArrayView<const FVector>(cross_section);
+    return TArrayView<const FVector>(cross_sections->data()
+                                     + cross_section_start,
+                                     cross_section_count);
+  }
   FRadiusInfo() {}
 };
@@ -0,0 +1,44 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RadiusInfo.h"
+#include "RadiusInfoLib.generated.h"
+
+/**
+ * Reading the cross section out of a RadiusInfo, without copying the whole
+ * thing (unless that's what you want).
+ */
+UCLASS(meta=(BlueprintThreadSafe), Category = "Shell Shape Generator")
+class SHELLGEN2_API URadiusInfoLib : public UBlueprintFunctionLibrary {
+  GENERATED_UCLASS_BODY()
+  /** How many points the cross section has. */
+  UFUNCTION(BlueprintPure, Category = "Shell Shape Generator")
+  static int32 GetCrossSectionLength(const FRadiusInfo& radius_info);
+  /** One point of the cross section. Out of range gives 0,0,0. */
+  UFUNCTION(BlueprintPure, Category = "Shell Shape Generator")
+  static FVector GetCrossSectionPoint(const FRadiusInfo& radius_info,
+                                      int32 index);
+  /** A copy of the whole cross section. */
+  UFUNCTION(BlueprintPure, Category = "Shell Shape Generator")
+  static TArray<FVector> GetCrossSection(const FRadiusInfo& radius_info);
+};
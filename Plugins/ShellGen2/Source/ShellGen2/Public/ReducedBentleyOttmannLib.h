@@ -30,10 +30,23 @@ class SHELLGEN2_API UReducedBentleyOttmannLib : public UBlueprintFunctionLibrary
    * Perform Reduced Bentley-Ottmann on the given transformed cross sections.
    * Returns a list giving every point at which the cross sections intersect.
    *
-   * Hopefully there are no exactly coincident endpoints between the two cross
-   * sections. That would be bad! Ha ha ha ha ha ha ha ha ha... haha...
+   * Coincident endpoints, overlapping edges, and several edges crossing at
+   * the same point are all fine now. Edges that share an endpoint don't count
+   * as crossing there.
    */
   UFUNCTION(BlueprintPure, Category = "Shell Shape Generator")
   static TArray<FVector2D> ReducedBentleyOttmann
     (const TArray<FTransformedCrossSection>& cross_sections);
+  /**
+   * Times ReducedBentleyOttmann against the old version (which tested every
+   * new edge against every edge the sweep line was crossing) on the given
+   * cross sections, running each one `iterations` times. The times are the
+   * average seconds per run. `same_results` tells whether both found the same
+   * crossing points (not counting order).
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  static void BenchmarkReducedBentleyOttmann
+    (const TArray<FTransformedCrossSection>& cross_sections,
+     int32 iterations,
+     float& old_seconds, float& new_seconds, bool& same_results);
 };
@@ -0,0 +1,63 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BakedMesh.h"
+#include "SelfIntersectionLib.generated.h"
+
+/**
+ * A place where a shell runs into itself: one stretch of rings passing
+ * through another, older stretch. Rings are counted from 0 at the young end
+ * (endcap rings included), in the order the generator made them.
+ */
+USTRUCT(BlueprintType, Category = "Shell Shape Generator")
+struct SHELLGEN2_API FShellSelfIntersection {
+  GENERATED_BODY()
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int32 young_first_ring = 0;
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int32 young_last_ring = 0;
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int32 old_first_ring = 0;
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int32 old_last_ring = 0;
+  /** Theta (in 180° units) of the first and last of the young rings. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) FVector2D young_thetas;
+  /** Theta of the first and last of the old rings. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) FVector2D old_thetas;
+  FShellSelfIntersection() {}
+};
+
+UCLASS(meta=(BlueprintThreadSafe), Category = "Shell Shape Generator")
+class SHELLGEN2_API USelfIntersectionLib : public UBlueprintFunctionLibrary {
+  GENERATED_UCLASS_BODY()
+  /**
+   * Check whether a shell passes through itself anywhere (whorls running
+   * into each other, usually), which ruins prints and makes for odd
+   * shading. Returns true if it does, and where, youngest first.
+   *
+   * Neighbouring rings are always allowed to touch. Meant for meshes
+   * straight from the shell generator (Distortions are fine); a mesh that's
+   * been optimized or simplified still gets checked, but the ring numbers
+   * stop meaning much. Quick enough to do after every generation.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  static bool FindSelfIntersections(const FBakedMesh& in,
+                                    TArray<FShellSelfIntersection>&
+                                    intersections);
+};
@@ -0,0 +1,76 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShellCacheLib.generated.h"
+
+/**
+ * How well the shell cache is doing. See UShellCacheLib.
+ */
+USTRUCT(BlueprintType, Category = "Shell Shape Generator")
+struct SHELLGEN2_API FShellCacheStats {
+  GENERATED_BODY()
+  /** How many times BeginGeneratingShell found its shell in the cache. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int64 hits = 0;
+  /** How many times it didn't, and had to generate the shell. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int64 misses = 0;
+  /** hits / (hits + misses), or 0 if there haven't been any yet. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float hit_rate = 0.0f;
+  /** How many shells are in the cache. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int32 shells_held = 0;
+  /** Roughly how much memory those shells take up, in bytes. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int64 bytes_held = 0;
+  /** The most memory the cache will hold onto, in bytes. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int64 budget = 0;
+  FShellCacheStats() {}
+};
+
+/**
+ * Every Shell Generator remembers the shells it made recently, in one cache
+ * shared by the whole process. Asking for a shell with exactly the same
+ * parameters and Distortions as one in the cache (say, after flipping a
+ * slider back to where it was) gives back the same mesh without generating
+ * it again.
+ */
+UCLASS(meta=(BlueprintThreadSafe), Category = "Shell Shape Generator")
+class SHELLGEN2_API UShellCacheLib : public UBlueprintFunctionLibrary {
+  GENERATED_UCLASS_BODY()
+  /**
+   * How often the cache has been useful since it was last cleared, and how
+   * much it's holding.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  static FShellCacheStats GetShellCacheStats();
+  /**
+   * Set how much memory (in bytes) the cache may hold onto. The least
+   * recently used shells are dropped to make room. The default is 256MiB. 0
+   * turns the cache off.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  static void SetShellCacheBudget(int64 Bytes);
+  /**
+   * Drop every shell in the cache, and reset the hit and miss counts.
+   * (Meshes still in use elsewhere stay valid.)
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  static void ClearShellCache();
+};
@@ -0,0 +1,99 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include <functional>
+#include <memory>
+#include "BakedMesh.h"
+#include "ShellExportJob.generated.h"
+
+struct export_progress;
+
+/**
+ * Which kind of file a Shell Export Job writes.
+ */
+UENUM(Category = "Shell Shape Generator")
+enum class ShellExportFormat : uint8 {
+  ExportObj UMETA(DisplayName = "OBJ"),
+  ExportAsciiStl UMETA(DisplayName = "STL (ASCII)"),
+  ExportBinaryStl UMETA(DisplayName = "STL (Binary)"),
+  // (with normals)
+  ExportGlb UMETA(DisplayName = "glTF (Binary)"),
+  Export3mf UMETA(DisplayName = "3MF"),
+};
+
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FShellExportProgress,
+                                   int64, TrianglesWritten,
+                                   int64, TrianglesTotal);
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FShellExportFinished,
+                                   bool, SavingSucceeded,
+                                   const FString&, FailureReason);
+
+/**
+ * An export that's running in the background, so that writing a big shell
+ * doesn't freeze the UI. Both delegates are only ever called on the game
+ * thread. The job keeps itself alive until it's done, so you don't have to
+ * hang on to it unless you want to cancel it.
+ */
+UCLASS(BlueprintType, Category = "Shell Shape Generator")
+class SHELLGEN2_API UShellExportJob : public UObject {
+  GENERATED_BODY()
+  std::shared_ptr<export_progress> progress;
+  FShellExportProgress on_progress;
+  FShellExportFinished on_finished;
+  bool finished = false;
+  void finish(bool ok, const FString& reason);
+public:
+  /**
+   * Start writing the given meshes to a file in the background. Takes the
+   * same inputs as the other writers. OnProgress gets called every so often
+   * with how many triangles have been written; OnFinished gets called
+   * exactly once, when the file is complete, has failed, or was cancelled.
+   */
+  UFUNCTION(BlueprintCallable, Category="Shell Shape Generator")
+  static UShellExportJob* BeginExport(ShellExportFormat Format,
+                                      const TArray<FString>& comments,
+                                      const TArray<FBakedMesh>& meshes,
+                                      const TArray<FTransform>& transforms,
+                                      const FString& filename,
+                                      FShellExportProgress OnProgress,
+                                      FShellExportFinished OnFinished);
+  /**
+   * Stop the export as soon as possible. The partial file gets deleted, and
+   * OnFinished will report failure (unless it had already finished).
+   */
+  UFUNCTION(BlueprintCallable, Category="Shell Shape Generator")
+  void Cancel();
+  UFUNCTION(BlueprintCallable, Category="Shell Shape Generator")
+  bool IsExportFinished() const { return finished; }
+  UFUNCTION(BlueprintCallable, Category="Shell Shape Generator")
+  void GetExportProgress(int64& TrianglesWritten, int64& TrianglesTotal) const;
+  /**
+   * The guts of BeginExport: runs `work` on the thread pool with the job's
+   * progress, and reports back like BeginExport does.
+   */
+  static UShellExportJob*
+  begin(std::function<bool(export_progress& progress, FString& failure_reason)>
+        work, FShellExportProgress OnProgress,
+        FShellExportFinished OnFinished);
+};
@@ -25,12 +25,21 @@
 #include "CoreMinimal.h"
 #include "BakedMesh.h"
 #include "CurveNode.h"
+#include "Distortion.h"
+#include "MakeStaticMeshLib.h"
 #include "RadiusInfo.h"
+#include "ShellExportJob.h"
+#include "ShellLOD.h"
+#include "SliceLayer.h"
+#include "WhorlOverlap.h"
 #include "ShellGenerator.generated.h"
 
 // hey, Ma! come see all the internal state that got leaked into my public API
 // because C++ is so goshdang primitive!
 
+struct shell_ring_sink;
+struct shell_cache_key;
+
 enum class CurveType { Circle, Flat };
 
 class SHELLGEN2_API Curve {
@@ -44,6 +53,11 @@ public:
   std::vector<FVector2D> evaluate_dynamic() const { return evaluate(-1); }
 };
 
+// The three cross sections, already evaluated and smooshed with their grain.
+struct SHELLGEN2_API shell_curves {
+  std::vector<FVector> young, old, aperture;
+};
+
 struct SHELLGEN2_API shell_params {
   float starting_normal_rad;
   float starting_binormal_rad;
@@ -89,14 +103,27 @@ struct SHELLGEN2_API shell_params {
 				       const std::vector<FVector>& apert_cross,
 				       std::vector<FVector>& temp,
 				       float theta) const;
-  void point_at(FBakedMesh& out, float theta) const;
-  void build_shell_at(FBakedMesh& out,
+  void point_at(std::vector<FVector>& positions,
+                std::vector<FVector2D>& texcoords, float theta) const;
+  void build_shell_at(std::vector<FVector>& positions,
+                      std::vector<FVector2D>& texcoords,
 		      const std::vector<FVector>& young_cross,
 		      const std::vector<FVector>& old_cross,
 		      const std::vector<FVector>& aperture_cross,
 		      std::vector<FVector>& temp,
 		      float theta, float scale) const;
-  void build_shell(FBakedMesh& out) const;
+  shell_curves smoosh() const;
+  TArray<FRadiusInfo> radius_info(const shell_curves& curves) const;
+  // How far theta advances after the ring at `theta`.
+  float theta_step(float theta) const;
+  // Feeds every ring of the shell, young end first, into `sink`.
+  void generate(const shell_curves& curves, shell_ring_sink& sink) const;
+  // How many triangles generate would make, without making them.
+  uint64 count_triangles(const shell_curves& curves) const;
+  // Builds the whole mesh, pushing each ring along its normal by
+  // `distortions` (if any) as soon as it's built.
+  void build_shell(FBakedMesh& out, const shell_curves& curves,
+                   const std::vector<distortion_snapshot>& distortions) const;
 };
 
 struct SHELLGEN2_API bg_gen_state {
@@ -105,19 +132,13 @@ struct SHELLGEN2_API bg_gen_state {
   FBakedMesh last_baked_mesh;
   TArray<FRadiusInfo> last_radius_info;
   shell_params desired_params, cur_params;
+  std::vector<distortion_snapshot> desired_distortions, cur_distortions;
+  std::shared_ptr<const shell_cache_key> desired_key, cur_key;
   bool params_available = false;
   bool processing = false, quitting = false;
+  bool copy_cross_sections = true;
   unsigned long generation = 0, finished_generation = 0;
-  bool first_segment_attached, last_segment_is_full;
   void bg_thread_func();
-  void attach_shell_segment(FBakedMesh& out,
-			    bool is_full, unsigned int num_points);
-  void build_shell_at(FBakedMesh& mesh,
-		      const std::vector<FVector>& young_cross,
-		      const std::vector<FVector>& old_cross,
-		      const std::vector<FVector>& aperture_cross,
-		      std::vector<FVector>& temp_cross,
-		      float target_theta, float radius = 1.f);
 };
 
 UCLASS(BlueprintType, Category = "Shell Shape Generator")
@@ -137,6 +158,10 @@ class SHELLGEN2_API UShellGenerator : public UObject {
    * generation process will be abandoned, though the last finished shell will
    * continue to be accessible.
    *
+   * If a shell with exactly the same parameters and Distortions was made
+   * recently (by any Shell Generator), it's finished straight away. See
+   * ShellCacheLib.
+   *
    * The endcap specifications give pairs of numbers. In each pair, the first
    * number is a theta offset (where positive is always OLDER and
    * negative is always YOUNGER) from whichever "end" of the shell it
@@ -217,6 +242,15 @@ class SHELLGEN2_API UShellGenerator : public UObject {
    */
   UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
   bool IsGenerationStillInProgress();
+  /**
+   * Apply these Distortions to every shell generated from now on, as it is
+   * being generated. This gives the same kind of result as passing the
+   * finished shell to ApplyDistortions, without the extra copy of the mesh.
+   * Takes effect at the next BeginGeneratingShell. Pass an empty array to
+   * stop distorting.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  void SetDistortions(const TArray<UDistortion*>& distortions);
   /**
    * Get the most recent generated shell.
    */
@@ -228,4 +262,81 @@ class SHELLGEN2_API UShellGenerator : public UObject {
    */
   UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
   FBakedMesh BlockForGeneratedShell(TArray<FRadiusInfo>& radius_info);
+  /**
+   * Whether TakeLastGeneratedShell and BlockForGeneratedShell fill in each
+   * RadiusInfo's cross_section array. On by default, for Blueprints that
+   * read it directly. Turn it off to skip the copying and read the cross
+   * sections through RadiusInfoLib instead.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  void SetCopyCrossSections(bool copy);
+  /**
+   * Generate the shell from the last BeginGeneratingShell (and the current
+   * Distortions) straight into a file, without ever holding the whole mesh
+   * in memory. Useful for shells too big to make the normal way. This
+   * blocks until the file is written; see BeginGeneratingShellToFile for a
+   * version that doesn't.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  void GenerateShellToFile(ShellExportFormat Format,
+                           const TArray<FString>& comments,
+                           const FString& filename,
+                           bool& saving_succeeded, FString& failure_reason);
+  /**
+   * Like GenerateShellToFile, but in the background, as an export job that
+   * can report progress and be cancelled.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  UShellExportJob* BeginGeneratingShellToFile(ShellExportFormat Format,
+                                              const TArray<FString>& comments,
+                                              const FString& filename,
+                                              FShellExportProgress OnProgress,
+                                              FShellExportFinished OnFinished);
+  /**
+   * Slice the shell from the last BeginGeneratingShell (and the current
+   * Distortions) into flat layers, like UShellSlicer::SliceMesh, without
+   * ever making the whole mesh. Blocks until it's done.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  TArray<FSliceLayer> SliceShell(float layer_height = 0.02f,
+                                 bool find_crossings = false);
+  /**
+   * Make a StaticMesh with several levels of detail from the shell from the
+   * last BeginGeneratingShell (and the current Distortions). Each LOD is
+   * generated separately at its own resolution, all at the same time.
+   * Blocks until it's done. Returns None if BeginGeneratingShell was never
+   * called.
+   *
+   * The LODs after the first one should go from biggest screen size to
+   * smallest. If they don't, they're put in that order.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  UStaticMesh* BuildShellWithLODs(const TArray<FShellLOD>& lods,
+                                  UPARAM(DisplayName="Compute tangents")
+                                  bool compute_tangents = true);
+  /**
+   * Like BuildShellWithLODs, but the LODs are made on worker threads and
+   * OnReady gets the StaticMesh on the game thread when it's done.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  void BeginBuildingShellWithLODs(const TArray<FShellLOD>& lods,
+                                  UPARAM(DisplayName="Compute tangents")
+                                  bool compute_tangents,
+                                  FStaticMeshReady OnReady);
+  /**
+   * Find where each whorl of the shell from the last BeginGeneratingShell
+   * runs into the whorl before it, all at once. The cross sections are
+   * compared `samples_per_whorl` times per turn, evenly spaced back from the
+   * open end, and all the comparisons run at the same time. Distortions
+   * aren't taken into account. Returns them youngest first, or nothing if
+   * BeginGeneratingShell was never called (or the shell isn't a whole turn
+   * old yet).
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  TArray<FWhorlOverlap> ComputeWhorlOverlaps(int samples_per_whorl = 1);
+private:
+  // Copies of what GenerateShellToFile (or SliceShell, etc.) should generate.
+  // False if there isn't anything yet.
+  bool get_desired_shell(shell_params& params,
+                         std::vector<distortion_snapshot>& distortions);
 };
@@ -0,0 +1,42 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShellLOD.generated.h"
+
+/**
+ * One level of detail of a shell's static mesh. Since the shell is made from
+ * its parameters, each LOD is generated again from scratch with a coarser
+ * resolution, not decimated from the full one.
+ */
+USTRUCT(BlueprintType, Category = "Shell Shape Generator")
+struct SHELLGEN2_API FShellLOD {
+  GENERATED_BODY()
+  /** "Distance per iteration" gets multiplied by this. Bigger is coarser. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float length_multiplier = 1.0f;
+  /** "Curve subdivision iterations" for this LOD. Smaller is coarser. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int curve_subdivision = 4;
+  /** Switch to this LOD once the shell is this big on screen (or smaller).
+      Ignored for the first LOD. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float screen_size = 1.0f;
+  FShellLOD() {}
+};
@@ -0,0 +1,61 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "BakedMesh.h"
+#include "SliceLayer.h"
+#include "ShellSlicer.generated.h"
+
+/**
+ * Cuts meshes into flat layers, for printing without going through a
+ * gigantic STL and an external slicer first. (To slice a shell without
+ * making the mesh at all, see UShellGenerator::SliceShell.)
+ */
+UCLASS(BlueprintType, Category = "Shell Shape Generator")
+class SHELLGEN2_API UShellSlicer : public UBlueprintFunctionLibrary {
+  GENERATED_BODY()
+public:
+  /**
+   * Cut the mesh with a horizontal plane every `layer_height` units, through
+   * the middle of each layer (so the planes are at half a layer, one and a
+   * half layers, etc.). Returns the outlines of every layer that isn't
+   * empty, bottom first. If `find_crossings` is set, each layer also lists
+   * the points where its outlines cross.
+   */
+  UFUNCTION(BlueprintCallable, Category="Shell Shape Generator")
+  static TArray<FSliceLayer> SliceMesh(const FBakedMesh& mesh,
+                                       float layer_height = 0.02f,
+                                       bool find_crossings = false);
+  /**
+   * Write layers as an SVG file, one group (with a `data-z` attribute) per
+   * layer, looking down from above.
+   */
+  UFUNCTION(BlueprintCallable, Category="Shell Shape Generator",
+            DisplayName="Output Slices SVG File")
+  static void OutputSlicesSvgFile(const TArray<FString>& comments,
+                                  const TArray<FSliceLayer>& layers,
+                                  const FString& filename,
+                                  bool& saving_succeeded,
+                                  FString& failure_reason);
+};
@@ -0,0 +1,92 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include <memory>
+#include "BakedMesh.h"
+#include "ShellSurfaceQuery.generated.h"
+
+struct shell_bvh;
+
+/**
+ * Where a ray or closest-point query met a shell's surface.
+ */
+USTRUCT(BlueprintType, Category = "Shell Shape Generator")
+struct SHELLGEN2_API FShellSurfaceHit {
+  GENERATED_BODY()
+  /** False if nothing was found (within the maximum distance). Nothing else
+      here means anything if so. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) bool hit = false;
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) FVector position;
+  /** The normal of the triangle that was hit, facing out of the shell. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) FVector normal;
+  /** How far along the ray, or how far away from the point. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float distance = 0.0f;
+  /** Where on the shell it is: theta (in 180° units) along the spiral... */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float theta = 0.0f;
+  /** ...and V (from -1 to 1) around the cross section. (The same as the
+      texture coordinates there.) */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float v = 0.0f;
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) int32 triangle = -1;
+  FShellSurfaceHit() {}
+};
+
+/**
+ * Answers ray casts and closest-point queries against a BakedMesh directly,
+ * for putting things on a shell without having to build a StaticMesh and
+ * cook its collision first. Positions are in the mesh's own space.
+ *
+ * It never changes after it's made, so queries can come from any thread,
+ * any number at a time.
+ */
+UCLASS(BlueprintType, Category = "Shell Shape Generator")
+class SHELLGEN2_API UShellSurfaceQuery : public UObject {
+  GENERATED_BODY()
+  std::shared_ptr<const shell_bvh> bvh;
+public:
+  /**
+   * Get a BakedMesh ready for queries. The mesh itself isn't copied; the
+   * query just keeps it alive.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  static UShellSurfaceQuery* MakeShellSurfaceQuery(const FBakedMesh& mesh);
+  /**
+   * Cast a ray from each of `origins` along the matching one of
+   * `directions` (which don't need to be normalized), and find the first
+   * place each one hits the shell, from either side. A `max_distance` of 0
+   * means no limit. All the rays are cast at once.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  TArray<FShellSurfaceHit> RayCast(const TArray<FVector>& origins,
+                                   const TArray<FVector>& directions,
+                                   float max_distance = 0.0f) const;
+  /**
+   * Find the nearest point on the shell to each of `points`. A
+   * `max_distance` of 0 means no limit. All the points are done at once.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Shell Shape Generator")
+  TArray<FShellSurfaceHit> ClosestPoints(const TArray<FVector>& points,
+                                         float max_distance = 0.0f) const;
+  /** For C++ callers that want to hang on to it without the UObject. */
+  std::shared_ptr<const shell_bvh> get_bvh() const { return bvh; }
+};
@@ -0,0 +1,49 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SliceLayer.generated.h"
+
+USTRUCT(BlueprintType, Category = "Shell Shape Generator")
+struct SHELLGEN2_API FSliceContour {
+  GENERATED_BODY()
+  /** The outline, in order, as seen from above. The last point is NOT a
+      repeat of the first. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) TArray<FVector2D> points;
+  /** False if the outline ran off the edge of the mesh (e.g. an open end of
+      the shell) instead of coming back around to where it started. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) bool closed = true;
+  FSliceContour() {}
+};
+
+USTRUCT(BlueprintType, Category = "Shell Shape Generator")
+struct SHELLGEN2_API FSliceLayer {
+  GENERATED_BODY()
+  /** Height of the cutting plane. (The middle of the layer.) */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float z = 0.0f;
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) TArray<FSliceContour> contours;
+  /** Every point where this layer's contours cross each other (or
+      themselves), if that was asked for. Crossings usually mean whorls that
+      run into each other, which a printer won't like. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) TArray<FVector2D> crossings;
+  FSliceLayer() {}
+};
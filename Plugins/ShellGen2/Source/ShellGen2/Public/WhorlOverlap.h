@@ -0,0 +1,43 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WhorlOverlap.generated.h"
+
+/**
+ * Where one whorl's cross section runs into the cross section of the whorl
+ * before it (one full turn, or 2 in 180° units, younger), seen in the plane
+ * through the shell's axis at that angle.
+ */
+USTRUCT(BlueprintType, Category = "Shell Shape Generator")
+struct SHELLGEN2_API FWhorlOverlap {
+  GENERATED_BODY()
+  /** Theta (in 180° units) of the older cross section. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float theta = 0.0f;
+  /** Theta of the younger one. Always theta - 2. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) float previous_theta = 0.0f;
+  /** Every point where the two cross sections cross each other (or
+      themselves). X is the distance from the shell's axis, Y is the height
+      along it. Empty if the whorls don't touch. */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite) TArray<FVector2D> crossings;
+  FWhorlOverlap() {}
+};
@@ -19,9 +19,12 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <cmath>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace {
   // modular modulo, assuming q is positive
@@ -36,11 +39,47 @@ namespace {
 
 extern const float BYTE_TO_FLOAT[256];
 struct SHELLGEN2_API loaded_gray_png {
+  // How many bytes of slop to allocate past the end of `pixels`. The gather
+  // path in `sample_many` reads four bytes at a time and throws three away.
+  static constexpr uint32_t PIXEL_PADDING = 4;
   uint32_t width, height;
-  std::unique_ptr<uint8_t[]> pixels;
-  std::unique_ptr<uint8_t*[]> rows;
+  // Row-major, width * height bytes (plus PIXEL_PADDING). This points either
+  // into a buffer we decoded the PNG into, or into a memory-mapped cache
+  // file. Either way, `storage` is what keeps it alive.
+  const uint8_t* pixels = nullptr;
+  std::shared_ptr<const void> storage;
+  std::unique_ptr<const uint8_t*[]> rows;
+  // If both dimensions are powers of two, we can wrap with a mask instead of
+  // a division. The masks and shift are only meaningful if `pow2` is true.
+  bool pow2 = false;
+  uint32_t width_mask = 0, height_mask = 0, width_shift = 0;
+  // One level of the mip chain. Texels are stored in 8x8 tiles (one cache
+  // line each), so a bilinear footprint almost always lands in one tile, and
+  // vertices on neighbouring rings tend to land in nearby tiles. (The full
+  // size image is `pixels` itself; it doesn't get a tiled copy.)
+  struct mip_level {
+    static constexpr uint32_t TILE_SHIFT = 3;
+    static constexpr uint32_t TILE_MASK = (1 << TILE_SHIFT) - 1;
+    uint32_t width, height, tiles_across;
+    std::unique_ptr<uint8_t[]> texels;
+    // x and y must already be wrapped into range
+    uint8_t at(uint32_t x, uint32_t y) const {
+      return texels[((((y >> TILE_SHIFT) * tiles_across) + (x >> TILE_SHIFT))
+                     << (TILE_SHIFT * 2))
+                    + ((y & TILE_MASK) << TILE_SHIFT) + (x & TILE_MASK)];
+    }
+    float sample(float u, float v, bool pow2) const;
+  };
+  // Call this once width, height, and pixels are all filled in. Sets up
+  // `rows`. (The mip chain waits until something needs it.)
+  void finish_loading();
+  // mips[0] is half the size of the image, each level after that is half the
+  // size of the one before it, down to 1x1. Empty for a 1x1 image. Built the
+  // first time it's asked for, since only footprint filtering uses it.
+  // Thread-safe.
+  const std::vector<mip_level>& mip_chain() const;
   // note: u and v are assumed not to be normalized!
-  float sample(float u, float v) {
+  float sample(float u, float v) const {
     float ufloor, vfloor, ufract, vfract;
     int32_t x, y;
     ufloor = floorf(u);
@@ -61,4 +100,34 @@ struct SHELLGEN2_API loaded_gray_png {
     float cd = (c * (1.0f - ufract)) + (d * ufract);
     return (ab * (1.0f - vfract)) + (cd * vfract);
   }
+  /**
+   * Sample `count` points at once, writing the results to `out`. Gives the
+   * same results as calling `sample` on each point, except that if
+   * `mirror_v` is true, negative V coordinates are mirrored (like
+   * UDistortion does when WrapAtV is false).
+   *
+   * Power-of-two images take a fast path (masks instead of modulos, and an
+   * AVX2 gather if the CPU we're running on has it). Everything else falls
+   * back to `sample`.
+   */
+  void sample_many(const float* us, const float* vs, float* out,
+                   size_t count, bool mirror_v);
+  /**
+   * Sample with a filter wide enough for the given footprint, which is how
+   * many (full size) texels lie between this point and its neighbours. A
+   * footprint of 1 or less gives the same result as `sample`. Bigger ones
+   * blend between the two nearest mip levels.
+   */
+  float sample_filtered(float u, float v, float footprint) const;
+  /**
+   * `sample_filtered`, many points at once. `mirror_v` is the same as in
+   * `sample_many`.
+   */
+  void sample_many_filtered(const float* us, const float* vs,
+                            const float* footprints, float* out,
+                            size_t count, bool mirror_v) const;
+private:
+  mutable std::vector<mip_level> mips;
+  mutable std::once_flag mips_built;
+  void build_mips() const;
 };
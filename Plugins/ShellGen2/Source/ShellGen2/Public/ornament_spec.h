@@ -0,0 +1,66 @@
+/*
+ * This file is part of Shell Shape Generator 2.
+ *
+ * Copyright ©2023 Olivia Jenkins
+ *
+ * Shell Shape Generator 2 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Shell Shape Generator 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Shell Shape Generator 2. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+
+/**
+ * A closed-form ornament: ribs that run around the tube, nodes on the ribs,
+ * and spiral cords that run along the shell. Evaluated directly from the
+ * texture coordinates the shell generator writes (theta in 180° units, so
+ * one whorl is 2.0; v from -1 to 1 around the cross section).
+ *
+ * Each feature is a raised cosine, sharpened by raising it to a power, and
+ * scaled by its height. The total is the raw sample that a Distortion then
+ * multiplies by its Magnitude.
+ */
+struct SHELLGEN2_API ornament_spec {
+  float ribs_per_whorl = 0.0f;
+  float rib_sharpness = 1.0f;
+  float rib_height = 0.0f;
+  float nodes_across_section = 0.0f;
+  float node_sharpness = 1.0f;
+  float node_height = 0.0f;
+  float spiral_cords = 0.0f;
+  float spiral_twist_per_whorl = 0.0f;
+  float spiral_sharpness = 1.0f;
+  float spiral_height = 0.0f;
+  bool operator==(const ornament_spec& other) const {
+    return ribs_per_whorl == other.ribs_per_whorl
+      && rib_sharpness == other.rib_sharpness
+      && rib_height == other.rib_height
+      && nodes_across_section == other.nodes_across_section
+      && node_sharpness == other.node_sharpness
+      && node_height == other.node_height
+      && spiral_cords == other.spiral_cords
+      && spiral_twist_per_whorl == other.spiral_twist_per_whorl
+      && spiral_sharpness == other.spiral_sharpness
+      && spiral_height == other.spiral_height;
+  }
+  float sample(float theta, float v) const;
+  /**
+   * Evaluate `count` points at once. Written as flat loops over plain arrays
+   * so the compiler can vectorize them.
+   */
+  void sample_many(const float* thetas, const float* vs, float* out,
+                   size_t count) const;
+};
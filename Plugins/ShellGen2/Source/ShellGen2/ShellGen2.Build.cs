@@ -24,6 +24,8 @@ public class ShellGen2 : ModuleRules
 	public ShellGen2(ReadOnlyTargetRules Target) : base(Target)
 	{
 		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+		// for std::to_chars (see fast_format.cpp)
+		CppStandard = CppStandardVersion.Cpp17;
 		
 		PublicIncludePaths.AddRange(
 			new string[] {